@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include "format/coff/pe.h"
 #include "syscall/simple_allocator.h"
 #include "syscall/syscall.h"
@@ -28,6 +29,18 @@ static size_t run_exception(miCPU* data, size_t index)
     return result;
 }
 
+static int run_effect(miCPU* data, size_t index, size_t* writes)
+{
+    int result = miCPU::EFFECT_NONE;
+    if (result == miCPU::EFFECT_NONE) {
+        result = syscall_windows_effect(data, index, writes);
+    }
+    if (result == miCPU::EFFECT_NONE) {
+        result = syscall_i386_effect(data, index, writes);
+    }
+    return result;
+}
+
 static size_t get_symbol(const char* file, const char* name)
 {
     size_t address = 0;
@@ -42,17 +55,37 @@ static size_t get_symbol(const char* file, const char* name)
 
 int main(int argc, const char* argv[])
 {
+    int journal = x86_i386::JOURNAL_OFF;
+    const char* journal_path = nullptr;
+    if (argc > 2 && strcmp(argv[1], "-record") == 0) {
+        journal = x86_i386::JOURNAL_RECORD;
+    }
+    else if (argc > 2 && strcmp(argv[1], "-replay") == 0) {
+        journal = x86_i386::JOURNAL_REPLAY;
+    }
+    if (journal != x86_i386::JOURNAL_OFF) {
+        journal_path = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
+
     if (argc <= 1) {
-        printf("micpu exe ...\n");
+        printf("micpu [-record journal | -replay journal] exe ...\n");
         return 0;
     }
 
     static const int allocatorSize = 16777216;
     static const int stackSize = 65536;
 
-    miCPU* cpu = new x86_i386;
+    x86_i386* cpu = new x86_i386;
     cpu->Initialize(simple_allocator<16>::construct(allocator_size), stack_size);
     cpu->Exception = run_exception;
+    cpu->Effect = run_effect;
+    if (cpu->Journal(journal_path, journal) == false) {
+        printf("%s : cannot open\n", journal_path);
+        delete cpu;
+        return 0;
+    }
 
     void* image = PE::Load(argv[1], [](size_t base, size_t size, void* userdata) {
         miCPU* cpu = (miCPU*)userdata;
@@ -5,7 +5,7 @@
 // https://github.com/metarutaiga/miCPU
 //==============================================================================
 #include "EmulatorPCH.h"
-#include <map>
+#include <algorithm>
 #include <IconFontCppHeaders/IconsFontAwesome4.h>
 #include <imgui_club/imgui_memory_editor/imgui_memory_editor.h>
 #include "format/coff/pe.h"
@@ -20,7 +20,7 @@ static miCPU* cpu;
 static std::string arguments;
 static std::string status;
 static std::string logs[3];
-static std::map<size_t, std::string> disasms;
+static std::vector<miCPU::Instruction> disasms;
 static int exportIndex;
 static std::vector<std::pair<std::string, size_t>> exports;
 //------------------------------------------------------------------------------
@@ -86,6 +86,18 @@ static size_t Exception(miCPU* data, size_t index)
     return result;
 }
 //------------------------------------------------------------------------------
+static int Effect(miCPU* data, size_t index, size_t* writes)
+{
+    int result = miCPU::EFFECT_NONE;
+    if (result == miCPU::EFFECT_NONE) {
+        result = syscall_windows_effect(data, index, writes);
+    }
+    if (result == miCPU::EFFECT_NONE) {
+        result = syscall_i386_effect(data, index, writes);
+    }
+    return result;
+}
+//------------------------------------------------------------------------------
 static size_t Symbol(const char* file, const char* name)
 {
     size_t address = 0;
@@ -98,6 +110,13 @@ static size_t Symbol(const char* file, const char* name)
     return address;
 }
 //------------------------------------------------------------------------------
+static std::vector<miCPU::Instruction>::iterator Lookup(size_t address)
+{
+    return std::lower_bound(disasms.begin(), disasms.end(), address, [](const miCPU::Instruction& instruction, size_t address) {
+        return instruction.address < address;
+    });
+}
+//------------------------------------------------------------------------------
 void Debugger::Initialize()
 {
     arguments = "main";
@@ -125,7 +144,7 @@ void Debugger::Shutdown()
     logs[0] = std::string();
     logs[1] = std::string();
     logs[2] = std::string();
-    disasms = std::map<size_t, std::string>();
+    disasms = std::vector<miCPU::Instruction>();
     samples = std::vector<std::pair<std::string, std::string>>();
 }
 //------------------------------------------------------------------------------
@@ -181,8 +200,6 @@ bool Debugger::Update(const UpdateData& updateData, bool& show)
 
         if (ImGui::Begin("Disassembly", nullptr, ImGuiWindowFlags_NoScrollbar)) {
             struct Local {
-                std::map<size_t, std::string>::iterator temp_it = disasms.begin();
-                int temp_index = 0;
                 char temp[128];
             } local;
 
@@ -190,21 +207,16 @@ bool Debugger::Update(const UpdateData& updateData, bool& show)
             ImGui::SetNextWindowSize(ImGui::GetContentRegionAvail());
             ImGui::ListBox("##10", &disasmIndex, &disasmFocus, [](void* user_data, int index) -> const char* {
                 Local& local = *(Local*)user_data;
-                if (local.temp_index != index) {
-                    local.temp_index = index;
-                    local.temp_it = disasms.begin();
-                    std::advance(local.temp_it, index);
-                }
-                auto& [address, disasm] = (*local.temp_it++);
-                local.temp_index++;
+                size_t address = disasms[index].address;
+                std::string disasm = cpu->Disassemble(disasms[index]);
 
                 const char* comment = nullptr;
                 auto comma = disasm.rfind(" ");
                 if (comma != std::string::npos) {
                     size_t address = strtoll(disasm.c_str() + comma + 2, nullptr, 16);
                     if (address) {
-                        auto it = disasms.lower_bound(address);
-                        if (it == disasms.end() || std::abs(int64_t(address - (*it).first)) > 16)
+                        auto it = Lookup(address);
+                        if (it == disasms.end() || std::abs(int64_t(address - (*it).address)) > 16)
                             comment = (char*)cpu->Memory(address);
                         if (comment && (address + 4) <= allocatorSize) {
                             uint32_t index = *(uint32_t*)comment;
@@ -385,6 +397,7 @@ bool Debugger::Update(const UpdateData& updateData, bool& show)
             cpu->BreakpointDataValue = breakpointData[1];
             cpu->BreakpointProgram = breakpointProgram;
             cpu->Exception = Exception;
+            cpu->Effect = Effect;
 
             void* image = PE::Load(file.c_str(), [](size_t base, size_t size, void* userdata) {
                 miCPU* cpu = (miCPU*)userdata;
@@ -398,31 +411,10 @@ bool Debugger::Update(const UpdateData& updateData, bool& show)
                     PE::SectionCode(image, &base, &address, &size);
                     size_t begin = base + address;
                     size_t end = begin + size;
-                    size_t program = cpu->Program();
-                    while (begin < end) {
-                        cpu->Jump(begin);
-                        std::string disasm = cpu->Disassemble(1);
-                        if (disasm.empty())
-                            break;
-                        if (disasm.back() == '\n')
-                            disasm.pop_back();
-                        size_t space = disasm.find("  ");
-                        if (space == std::string::npos)
-                            space = 15;
-                        size_t address = strtoll(disasm.c_str(), nullptr, 16);
-                        disasms[address] = disasm;
-                        begin += (space - 8 - 3) / 2;
-                    }
-//                  auto it = disasms.lower_bound(end);
-//                  if (it != disasms.begin())
-//                      it--;
-//                  while (it != disasms.begin()) {
-//                      auto rem = it--;
-//                      if ((*rem).second.find("0000  ") == std::string::npos)
-//                          break;
-//                      disasms.erase(rem);
-//                  }
-                    cpu->Jump(program);
+                    std::vector<miCPU::Instruction> instructions;
+                    cpu->Disassemble(begin, end, instructions);
+                    disasms.erase(Lookup(begin), Lookup(end));
+                    disasms.insert(Lookup(begin), instructions.begin(), instructions.end());
                 };
 
                 std::vector<std::string> parsed;
@@ -458,10 +450,11 @@ bool Debugger::Update(const UpdateData& updateData, bool& show)
         }
 
         if (running) {
-            if (cpu && cpu->Step('INTO')) {
+            if (cpu && cpu->RunFor(SIZE_MAX, 8000) == miCPU::RUN_DEADLINE) {
                 refresh = true;
             }
             else {
+                refresh = true;
                 running = false;
             }
         }
@@ -471,8 +464,8 @@ bool Debugger::Update(const UpdateData& updateData, bool& show)
             if (cpu) {
                 status = cpu->Status();
 
-                auto it = disasms.find(cpu->Program());
-                if (it != disasms.end()) {
+                auto it = Lookup(cpu->Program());
+                if (it != disasms.end() && (*it).address == cpu->Program()) {
                     disasmIndex = disasmFocus = (int)std::distance(disasms.begin(), it);
                 }
 
@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include <sys/mman.h>
+#include "riscv/riscv_cpu.h"
+
+// Runs random loops through run, which translates hot blocks, and through issue, which never does
+static std::mt19937 random_engine;
+
+static int Random(int count)
+{
+    return int(random_engine() % count);
+}
+
+static uint32_t R(int funct7, int rs2, int rs1, int funct3, int rd, int opcode)
+{
+    return funct7 << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+}
+
+static uint32_t I(int imm, int rs1, int funct3, int rd, int opcode)
+{
+    return (imm & 0xFFF) << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+}
+
+static uint32_t S(int imm, int rs2, int rs1, int funct3, int opcode)
+{
+    return ((imm >> 5) & 0x7F) << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | (imm & 0x1F) << 7 | opcode;
+}
+
+static uint32_t B(int imm, int rs2, int rs1, int funct3)
+{
+    return ((imm >> 12) & 1) << 31 | ((imm >> 5) & 0x3F) << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | ((imm >> 1) & 0xF) << 8 | ((imm >> 11) & 1) << 7 | 0x63;
+}
+
+static uint32_t J(int imm, int rd)
+{
+    return ((imm >> 20) & 1) << 31 | ((imm >> 1) & 0x3FF) << 21 | ((imm >> 11) & 1) << 20 | ((imm >> 12) & 0xFF) << 12 | rd << 7 | 0x6F;
+}
+
+// x2 is the stack, x5 the data pointer and x6 the loop counter
+static int Destination()
+{
+    int rd;
+    do rd = Random(32); while (rd == 2 || rd == 5 || rd == 6);
+    return rd;
+}
+
+static int Source()
+{
+    return Random(32) == 0 ? 5 : Random(32);
+}
+
+static void Generate(std::vector<uint32_t>& program)
+{
+    static const int shifts[] = { 0, 1, 5, 5 };
+    static const int words[] = { 0, 1, 5, 5, 0 };
+    static const int multiplies[] = { 0, 4, 5, 6, 7 };
+    static const int branches[] = { 0, 1, 4, 5, 6, 7 };
+    static const int floats[] = { 0, 1, 2, 3, 11 };
+
+    int rd = Destination();
+    int rs1 = Source();
+    int rs2 = Source();
+    int imm = Random(4096) - 2048;
+    int offset = Random(256) * 8;
+
+    switch (Random(40)) {
+    case 0:     // LUI
+        program.push_back(uint32_t(random_engine()) << 12 | rd << 7 | 0x37);
+        break;
+    case 1:     // AUIPC
+        program.push_back(uint32_t(random_engine()) << 12 | rd << 7 | 0x17);
+        break;
+    case 2: {   // OP-IMM, shifts with a random amount and an occasional reserved funct6
+        int funct3 = Random(8);
+        if (funct3 == 1 || funct3 == 5) {
+            int funct6 = (funct3 == 5 && Random(2)) ? 0x10 : 0;
+            if (Random(10) == 0)
+                funct6 = 0x18;
+            program.push_back(I(funct6 << 6 | Random(64), rs1, funct3, rd, 0x13));
+        }
+        else {
+            program.push_back(I(imm, rs1, funct3, rd, 0x13));
+        }
+        break;
+    }
+    case 3: {   // OP-IMM-32
+        int funct3 = shifts[Random(4)];
+        int funct7 = (funct3 == 5 && Random(2)) ? 0x20 : 0;
+        program.push_back(funct3 ? R(funct7, Random(32), rs1, funct3, rd, 0x1B) : I(imm, rs1, 0, rd, 0x1B));
+        break;
+    }
+    case 4:
+    case 5:
+    case 6: {   // OP and M extension
+        int funct3 = Random(8);
+        int funct7 = (funct3 == 0 || funct3 == 5) && Random(2) ? 0x20 : 0;
+        if (Random(4) == 0)
+            funct7 = 1;
+        program.push_back(R(funct7, rs2, rs1, funct3, rd, 0x33));
+        break;
+    }
+    case 7: {   // OP-32 and M extension
+        int funct3 = words[Random(5)];
+        int funct7 = (funct3 == 0 || funct3 == 5) && Random(2) ? 0x20 : 0;
+        if (Random(5) == 0) {
+            funct7 = 1;
+            funct3 = multiplies[Random(5)];
+        }
+        program.push_back(R(funct7, rs2, rs1, funct3, rd, 0x3B));
+        break;
+    }
+    case 8:
+    case 9: {   // Loads, naturally aligned
+        int funct3 = Random(7);
+        program.push_back(I(offset & ~((1 << (funct3 & 3)) - 1), 5, funct3, rd, 0x03));
+        break;
+    }
+    case 10:
+    case 11:    // Stores
+        program.push_back(S(offset, rs2, 5, Random(4), 0x23));
+        break;
+    case 12:    // FLW
+        program.push_back(I(offset & ~3, 5, 2, Random(32), 0x07));
+        break;
+    case 13:    // FSW
+        program.push_back(S(offset & ~3, Random(32), 5, 2, 0x27));
+        break;
+    case 14:
+    case 15:
+    case 16:    // FADD.S, FSUB.S, FMUL.S, FDIV.S, FSQRT.S with RNE or DYN
+        program.push_back(R(floats[Random(5)] << 2, Random(32), Random(32), Random(8) == 0 ? 7 : 0, Random(32), 0x53));
+        break;
+    case 17:    // FMV.X.W
+        program.push_back(R(0x70, 0, Random(32), 0, rd, 0x53));
+        break;
+    case 18:    // FMV.W.X
+        program.push_back(R(0x78, 0, rs1, 0, Random(32), 0x53));
+        break;
+    case 19:    // FENCE
+        program.push_back(0x0FF0000F);
+        break;
+    case 20:
+    case 21:    // Forward branch over up to 3 instructions
+        program.push_back(B(4 * (2 + Random(3)), rs2, rs1, branches[Random(6)]));
+        break;
+    case 22:    // Forward jump over up to 3 instructions
+        program.push_back(J(4 * (2 + Random(3)), Random(2) ? 0 : rd));
+        break;
+    case 23:    // FMIN.S, left to the interpreter
+        program.push_back(R(0x14, rs2, rs1, 0, rd, 0x53));
+        break;
+    case 24:    // FEQ.S
+        program.push_back(R(0x50, Random(32), Random(32), 2, rd, 0x53));
+        break;
+    default: {  // OP-IMM without shifts
+        int funct3 = Random(8);
+        if (funct3 == 1 || funct3 == 5)
+            funct3 = 0;
+        program.push_back(I(imm, rs1, funct3, rd, 0x13));
+        break;
+    }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 300;
+    int mismatched = 0;
+
+    static const float specials[] = { 0.0f, -0.0f, 1.0f, -1.5f, 1e30f, 1e-40f, __builtin_inff(), -__builtin_inff(), __builtin_nanf(""), 3.14159f };
+
+    uint32_t* code = (uint32_t*)mmap(nullptr, 65536, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    std::vector<uint8_t> initial(8192);
+    std::vector<uint8_t> data(8192);
+    std::vector<uint8_t> result[2] = { std::vector<uint8_t>(8192), std::vector<uint8_t>(8192) };
+
+    for (int seed = 0; seed < count; ++seed) {
+        random_engine.seed(seed);
+
+        std::vector<uint32_t> program;
+        int body = 10 + Random(60);
+        for (int i = 0; i < body; ++i)
+            Generate(program);
+
+        // NOPs to land the forward branches ; ADDI x6, x6, -1 ; BNE x6, x0, loop
+        for (int i = 0; i < 4; ++i)
+            program.push_back(I(0, 0, 0, 0, 0x13));
+        int back = -4 * int(program.size() + 1);
+        program.push_back(I(-1, 6, 0, 6, 0x13));
+        program.push_back(B(back, 0, 6, 1));
+        memcpy(code, program.data(), program.size() * sizeof(uint32_t));
+
+        uint64_t integers[32];
+        uint32_t singles[32];
+        for (auto& value : integers)
+            value = uint64_t(random_engine()) << 32 | random_engine();
+        for (auto& value : singles) {
+            float single = Random(3) ? specials[Random(10)] : float(random_engine() % 1000000) / 1000.0f;
+            memcpy(&value, &single, sizeof(value));
+        }
+        for (auto& value : initial)
+            value = uint8_t(random_engine());
+        int iterations = 100 + Random(200);
+
+        riscv_cpu* cpu[2] = { new riscv_cpu, new riscv_cpu };
+        for (int pass = 0; pass < 2; ++pass) {
+            riscv_cpu& hart = *cpu[pass];
+            memcpy(data.data(), initial.data(), initial.size());
+            hart.program(code, program.size() * sizeof(uint32_t));
+            for (int i = 1; i < 32; ++i)
+                hart.x[i].u = integers[i];
+            for (int i = 0; i < 32; ++i)
+                hart.f[i].u = singles[i];
+            hart.x[5].u = uintptr_t(data.data());
+            hart.x[6].u = iterations;
+
+            if (pass == 0)
+                hart.run();
+            else
+                while (hart.pc >= hart.begin && hart.pc < hart.end && hart.issue()) {}
+            memcpy(result[pass].data(), data.data(), data.size());
+        }
+
+        riscv_cpu& a = *cpu[0];
+        riscv_cpu& b = *cpu[1];
+        bool same = a.pc == b.pc && a.instret == b.instret && a.fcsr.u == b.fcsr.u;
+        same = same && memcmp(result[0].data(), result[1].data(), data.size()) == 0;
+        for (int i = 1; i < 32; ++i)
+            same = same && a.x[i].u == b.x[i].u && a.f[i].u == b.f[i].u;
+        for (int i = 0; i < riscv_cpu::HPM_COUNT; ++i)
+            same = same && a.hpmcounter[i] == b.hpmcounter[i];
+        if (same == false && mismatched++ < 8) {
+            printf("seed %d : pc %d instret %llu/%llu fcsr %X/%X\n", seed, a.pc == b.pc, (unsigned long long)a.instret, (unsigned long long)b.instret, unsigned(a.fcsr.u), unsigned(b.fcsr.u));
+            for (int i = 1; i < 32; ++i) {
+                if (a.x[i].u != b.x[i].u)
+                    printf("  x%d %016llX/%016llX\n", i, (unsigned long long)a.x[i].u, (unsigned long long)b.x[i].u);
+                if (a.f[i].u != b.f[i].u)
+                    printf("  f%d %016llX/%016llX\n", i, (unsigned long long)a.f[i].u, (unsigned long long)b.f[i].u);
+            }
+        }
+
+        delete cpu[0];
+        delete cpu[1];
+    }
+
+    munmap(code, 65536);
+
+    printf("seeds %d, mismatched %d\n", count, mismatched);
+    return mismatched ? 1 : 0;
+}
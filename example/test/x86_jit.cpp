@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "syscall/simple_allocator.h"
+#include "x86/x86_i386.h"
+#include "x86/x86_register.h"
+
+// Runs random loops through RunFor, which translates hot blocks, and through Step, which never does
+static std::mt19937 random_engine;
+
+static int Random(int count)
+{
+    return int(random_engine() % count);
+}
+
+static int Destination()
+{
+    static const int registers[] = { 0, 1, 2, 3, 6, 7 };   // ECX, ESP and EBP drive the loop
+    return registers[Random(6)];
+}
+
+static void Immediate(std::vector<uint8_t>& program)
+{
+    uint32_t value = random_engine();
+    program.insert(program.end(), (uint8_t*)&value, (uint8_t*)&value + 4);
+}
+
+static void Generate(std::vector<uint8_t>& program)
+{
+    static const uint8_t alu[] = { 0x01, 0x09, 0x11, 0x19, 0x21, 0x29, 0x31, 0x39, 0x03, 0x0B, 0x13, 0x1B, 0x23, 0x2B, 0x33, 0x3B, 0x85, 0x89, 0x8B };
+
+    switch (Random(12)) {
+    case 0:     // ALU reg, reg
+        program.insert(program.end(), { alu[Random(19)], uint8_t(0xC0 | Destination() << 3 | Destination()) });
+        break;
+    case 1:     // ALU reg, [EBP+disp8]
+        program.insert(program.end(), { alu[Random(19)], uint8_t(0x45 | Destination() << 3), uint8_t(Random(16) * 4) });
+        break;
+    case 2:     // grp1 reg, imm8
+        program.insert(program.end(), { 0x83, uint8_t(0xC0 | Random(8) << 3 | Destination()), uint8_t(Random(256)) });
+        break;
+    case 3:     // grp1 DWORD PTR [EBP+disp8], imm32
+        program.insert(program.end(), { 0x81, uint8_t(0x45 | Random(8) << 3), uint8_t(Random(16) * 4) });
+        Immediate(program);
+        break;
+    case 4:     // INC or DEC reg
+        program.push_back(uint8_t(0x40 | Random(2) << 3 | Destination()));
+        break;
+    case 5:     // MOV reg, imm32
+        program.push_back(uint8_t(0xB8 | Destination()));
+        Immediate(program);
+        break;
+    case 6:     // PUSH reg, POP reg
+        program.insert(program.end(), { uint8_t(0x50 | Destination()), uint8_t(0x58 | Destination()) });
+        break;
+    case 7:     // LEA reg, [EBP+index*scale+disp8]
+        program.insert(program.end(), { 0x8D, uint8_t(0x44 | Destination() << 3), uint8_t(Random(4) << 6 | Destination() << 3 | 5), uint8_t(Random(256)) });
+        break;
+    case 8:     // ALU EAX, imm32
+        program.push_back(uint8_t(0x05 | Random(8) << 3));
+        Immediate(program);
+        break;
+    case 9:     // TEST EAX, imm32
+        program.push_back(0xA9);
+        Immediate(program);
+        break;
+    case 10:    // PUSH imm8, POP reg
+        program.insert(program.end(), { 0x6A, uint8_t(Random(256)), uint8_t(0x58 | Destination()) });
+        break;
+    case 11:    // MOV DWORD PTR [EBP+disp8], imm32
+        program.insert(program.end(), { 0xC7, 0x45, uint8_t(Random(16) * 4) });
+        Immediate(program);
+        break;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 3000;
+    int mismatched = 0;
+
+    for (int seed = 0; seed < count; ++seed) {
+        random_engine.seed(seed);
+
+        // MOV ECX, 200 ; MOV EBP, 0x3000 ; loop: PUSH ECX
+        std::vector<uint8_t> program = { 0xB9, 200, 0, 0, 0, 0xBD, 0x00, 0x30, 0, 0 };
+        size_t loop = program.size();
+        program.push_back(0x51);
+        int body = 1 + Random(12);
+        for (int i = 0; i < body; ++i)
+            Generate(program);
+
+        // Jcc over a NOP ; POP ECX ; DEC ECX ; JNZ loop ; RET
+        program.insert(program.end(), { uint8_t(0x70 | Random(16)), 0x01, 0x90 });
+        program.insert(program.end(), { 0x59, 0x49 });
+        int32_t relative = int32_t(loop) - int32_t(program.size() + 6);
+        program.insert(program.end(), { 0x0F, 0x85 });
+        program.insert(program.end(), (uint8_t*)&relative, (uint8_t*)&relative + 4);
+        program.push_back(0xC3);
+
+        uint32_t registers[2][10];
+        uint8_t data[2][128];
+        for (int pass = 0; pass < 2; ++pass) {
+            x86_i386 cpu;
+            cpu.Initialize(simple_allocator<16>::construct(16777216), 65536);
+            uint8_t* memory = cpu.Memory(0x1000, 0x3000);
+            memcpy(memory, program.data(), program.size());
+            std::mt19937 fill(seed);
+            for (int i = 0; i < 1024; ++i)
+                memory[0x2000 + i] = uint8_t(fill());
+            cpu.Jump(0x1000);
+            memset(cpu.Memory() + cpu.Stack(), 0, sizeof(uint32_t));
+
+            if (pass == 0)
+                cpu.RunFor(SIZE_MAX, 0);
+            else
+                while (cpu.Step('INTO')) {}
+
+            auto& x86 = *(x86_register*)cpu.Register('x86 ');
+            for (int i = 0; i < 8; ++i)
+                registers[pass][i] = x86.regs[i].d;
+            registers[pass][8] = x86.flags.d & 0x8C5;   // OF SF ZF PF CF
+            registers[pass][9] = x86.ip.d;
+            memcpy(data[pass], cpu.Memory() + 0x3000, 128);
+        }
+
+        if (memcmp(registers[0], registers[1], sizeof(registers[0])) == 0 && memcmp(data[0], data[1], sizeof(data[0])) == 0)
+            continue;
+        if (mismatched++ < 8) {
+            printf("seed %d :", seed);
+            for (int i = 0; i < 10; ++i)
+                printf(" %08X/%08X", registers[0][i], registers[1][i]);
+            printf("\n");
+        }
+    }
+
+    printf("seeds %d, mismatched %d\n", count, mismatched);
+    return mismatched ? 1 : 0;
+}
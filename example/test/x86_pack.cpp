@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "x86/x86_i686.h"
+
+// Decodes random bytes and checks that every Format survives Pack and Unpack
+struct x86_pack : public x86_i686
+{
+    size_t packed = 0;
+    size_t decoded = 0;
+    size_t mismatched = 0;
+
+    static bool Same(const Format& a, const Format& b)
+    {
+        if (a.operation != b.operation || a.instruction != b.instruction || strcmp(a.segment, b.segment) != 0)
+            return false;
+        if (a.width != b.width || a.length != b.length || a.address != b.address)
+            return false;
+        if (a.repeatF2 != b.repeatF2 || a.repeatF3 != b.repeatF3)
+            return false;
+        for (int i = 0; i < 3; ++i) {
+            auto& x = a.operand[i];
+            auto& y = b.operand[i];
+            if (x.type != y.type || x.flags != y.flags || x.scale != y.scale || x.base != y.base || x.displacement != y.displacement)
+                return false;
+            if (x.scale && x.index != y.index)
+                return false;
+        }
+        return true;
+    }
+
+    void Run(uint8_t* memory, size_t size)
+    {
+        memory_address = memory;
+        memory_size = size;
+
+        auto& x86 = *(x86_register*)Register('x86 ');
+        auto& x87 = *(x87_register*)Register('x87 ');
+        auto& mmx = *(mmx_register*)Register('mmx ');
+        auto& sse = *(sse_register*)Register('sse ');
+
+        x86.ip.d = 0;
+        while (x86.ip.d < size - 16) {
+            uint32_t address = x86.ip.d;
+
+            Format format;
+            StepInternal(*this, format);
+            if (x86.ip.d <= address)
+                x86.ip.d = address + 1;
+            decoded++;
+
+            Packed pack;
+            if (Pack(format, pack) == false)
+                continue;
+            packed++;
+
+            Format unpack;
+            Unpack(pack, unpack);
+            if (Same(format, unpack) && Disasm(format, x86, x87, mmx, sse) == Disasm(unpack, x86, x87, mmx, sse))
+                continue;
+            if (mismatched++ < 8) {
+                printf("%08X : %s\n", address, Disasm(format, x86, x87, mmx, sse).c_str());
+                printf("%08X : %s\n", address, Disasm(unpack, x86, x87, mmx, sse).c_str());
+            }
+        }
+    }
+};
+
+int main(int argc, const char* argv[])
+{
+    size_t size = 2 * 1024 * 1024;
+    std::vector<uint8_t> memory(size);
+    std::mt19937 random(argc > 1 ? atoi(argv[1]) : 1);
+    for (auto& value : memory)
+        value = uint8_t(random());
+
+    x86_pack x86;
+    x86.Run(memory.data(), memory.size());
+
+    printf("decoded %zu, packed %zu, mismatched %zu\n", x86.decoded, x86.packed, x86.mismatched);
+    return x86.mismatched ? 1 : 0;
+}
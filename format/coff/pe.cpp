@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "mapfile.h"
 #include "mz.h"
 #include "pe.h"
 
@@ -62,30 +63,31 @@ void* PE::Load(const char* path, uint8_t*(*mmap)(size_t, size_t, void*), void* m
     if (path == nullptr || mmap == nullptr || log == nullptr)
         return nullptr;
 
-    FILE* file = fopen(path, "rb");
+    size_t size = 0;
+    uint8_t* file = MapFile(path, &size);
     if (file == nullptr)
         return nullptr;
 
-    fseek(file, 0, SEEK_END);
-    size_t size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    // Read PE offset from MZ
-    MZ::FileHeader mz = {};
-    fread(&mz, sizeof(MZ::FileHeader), 1, file);
-
     uint8_t* image = nullptr;
-    SectionHeader* sections = nullptr;
     switch (NULL) case NULL: {
-        if (mz.e_lfanew >= size || fseek(file, mz.e_lfanew, SEEK_SET) != 0) {
+        // Read PE offset from MZ
+        if (size < sizeof(MZ::FileHeader)) {
+            log("the file is too small");
+            break;
+        }
+        auto& mz = *(MZ::FileHeader*)file;
+        size_t offset = mz.e_lfanew;
+        if (offset >= size || size - offset < sizeof(int32_t) + sizeof(FileHeader) + sizeof(OptionalHeader)) {
             log("the PE offset is out of range");
             break;
         }
         int32_t signature = 0;
-        if (fread(&signature, sizeof(int32_t), 1, file) != 1 || signature != 0x4550) {
+        memcpy(&signature, file + offset, sizeof(int32_t));
+        if (signature != 0x4550) {
             log("the signature is not PE");
             break;
         }
+        offset += sizeof(int32_t);
 
         // File Name
         const char* name = strrchr(path, '/');
@@ -97,10 +99,8 @@ void* PE::Load(const char* path, uint8_t*(*mmap)(size_t, size_t, void*), void* m
 
         // File Header
         FileHeader fileHeader = {};
-        if (fread(&fileHeader, sizeof(FileHeader), 1, file) != 1) {
-            log("get the PE/COFF File Header is failed");
-            break;
-        }
+        memcpy(&fileHeader, file + offset, sizeof(FileHeader));
+        offset += sizeof(FileHeader);
         log("%-12s : %s", "file", name);
         log("%-12s : %s", "f_magic", GetMagic(fileHeader.f_magic));
         log("%-12s : %d", "f_nscns", fileHeader.f_nscns);
@@ -112,39 +112,44 @@ void* PE::Load(const char* path, uint8_t*(*mmap)(size_t, size_t, void*), void* m
 
         // Optional Header
         OptionalHeader optionalHeader = {};
-        if (sizeof(optionalHeader) != fileHeader.f_opthdr || fread(&optionalHeader, sizeof(OptionalHeader), 1, file) != 1) {
+        if (sizeof(optionalHeader) != fileHeader.f_opthdr) {
             log("get the PE/COFF Optional Header is failed");
             break;
         }
+        memcpy(&optionalHeader, file + offset, sizeof(OptionalHeader));
+        offset += sizeof(OptionalHeader);
         log("%-12s : 0x%08x", "SizeOfCode", optionalHeader.SizeOfCode);
         log("%-12s : 0x%08x", "BaseOfCode", optionalHeader.BaseOfCode);
         log("%-12s : 0x%08x", "EntryPoint", optionalHeader.AddressOfEntryPoint);
         log("%-12s : 0x%08x", "ImageBase", optionalHeader.ImageBase);
 
         // Section Header
-        sections = new SectionHeader[fileHeader.f_nscns]{};
-        if (sections == nullptr) {
-            log("out of memory");
-            break;
-        }
-        if (fread(sections, sizeof(SectionHeader), fileHeader.f_nscns, file) != fileHeader.f_nscns) {
+        if (size - offset < sizeof(SectionHeader) * fileHeader.f_nscns) {
             log("get the PE/COFF Section Header is failed");
             break;
         }
+        auto* sections = (SectionHeader*)(file + offset);
+        bool ordered = true;
         for (uint16_t i = 0; i < fileHeader.f_nscns; ++i) {
             const SectionHeader& section = sections[i];
             log("%-12s : %d %08X %08X %s", "Section", i, section.s_vaddr, section.s_size, section.s_name);
+            if (i && uint32_t(section.s_vaddr) < uint32_t(sections[i - 1].s_vaddr))
+                ordered = false;
         }
 
         // Load sections to memory
         log("%-12s : 0x%08X", "Base", optionalHeader.ImageBase);
         log("%-12s : 0x%08X", "Size", optionalHeader.SizeOfImage);
+        size_t headerSize = sizeof(int32_t) + sizeof(FileHeader) + sizeof(OptionalHeader);
+        if (optionalHeader.SizeOfImage < headerSize) {
+            log("the PE/COFF Image is too small");
+            break;
+        }
         image = mmap(optionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].Size ? 0 : optionalHeader.ImageBase, optionalHeader.SizeOfImage, mmap_data);
         if (image == nullptr) {
             log("out of memory");
             break;
         }
-        memset(image, 0, optionalHeader.SizeOfImage);
 
         // Relocation
         void* memory = mmap(0, 0, mmap_data);
@@ -161,46 +166,58 @@ void* PE::Load(const char* path, uint8_t*(*mmap)(size_t, size_t, void*), void* m
         memcpy(image + sizeof(int32_t) + sizeof(FileHeader), &optionalHeader, sizeof(OptionalHeader));
 
         // Section
+        // Only the gaps between sections are cleared, sections are copied straight from the mapping
+        size_t cursor = headerSize;
+        if (ordered == false) {
+            memset(image + cursor, 0, optionalHeader.SizeOfImage - cursor);
+            cursor = optionalHeader.SizeOfImage;
+        }
         bool finish = true;
-        void* reloc = nullptr;
+        const void* reloc = nullptr;
         for (uint16_t i = 0; i < fileHeader.f_nscns; ++i) {
             const SectionHeader& section = sections[i];
             if (section.s_size == 0)
                 continue;
-            void* to = nullptr;
-            if (section.s_flags & (IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE)) {
-                to = image + section.s_vaddr;
+            size_t from = uint32_t(section.s_scnptr);
+            size_t count = uint32_t(section.s_size);
+            if (from > size || size - from < count) {
+                log("get the PE/COFF Section Image is failed");
+                finish = false;
+                break;
             }
-            if (strcmp(section.s_name, ".reloc") == 0) {
-                to = reloc = realloc(reloc, section.s_size);
+            if (strncmp(section.s_name, ".reloc", sizeof(section.s_name)) == 0) {
+                reloc = file + from;
             }
-            if (to == nullptr)
+            if ((section.s_flags & (IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE)) == 0)
                 continue;
-            finish = false;
-            if (fseek(file, section.s_scnptr, SEEK_SET) != 0) {
-                log("fseek failed");
-                break;
-            }
-            if (fread(to, section.s_size, 1, file) != 1) {
+            size_t to = uint32_t(section.s_vaddr);
+            if (to < headerSize || to >= optionalHeader.SizeOfImage) {
                 log("get the PE/COFF Section Image is failed");
+                finish = false;
                 break;
             }
-            finish = true;
+            if (count > optionalHeader.SizeOfImage - to)
+                count = optionalHeader.SizeOfImage - to;
+            if (to > cursor)
+                memset(image + cursor, 0, to - cursor);
+            memcpy(image + to, file + from, count);
+            if (cursor < to + count)
+                cursor = to + count;
         }
         if (finish == false)
             break;
+        if (cursor < optionalHeader.SizeOfImage)
+            memset(image + cursor, 0, optionalHeader.SizeOfImage - cursor);
 
         // Relocation
         if (reloc) {
-            Relocate(image, reloc, new_base - old_base, log);
-            free(reloc);
+            Relocate(image, (void*)reloc, int64_t(new_base) - int64_t(old_base), log);
         }
 
         log("succeed");
     }
 
-    delete[] sections;
-    fclose(file);
+    UnmapFile(file, size);
     return image;
 }
 
@@ -279,30 +296,127 @@ void PE::Exports(void* image, void(*sym)(const char*, size_t, void*), void* sym_
     }
 }
 
+bool PE::Rebase(void* image, size_t base, int(*log)(const char*, ...))
+{
+    if (image == nullptr || log == nullptr)
+        return false;
+
+    auto image8 = (uint8_t*)image;
+    OptionalHeader& optionalHeader = *(OptionalHeader*)(image8 + sizeof(int32_t) + sizeof(FileHeader));
+    size_t delta = int64_t(base) - int64_t(optionalHeader.ImageBase);
+    if (delta == 0)
+        return true;
+
+    // The relocation table must be loaded in the image
+    auto& directory = optionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+    if (directory.Size < sizeof(ImageBaseRelocation) || directory.Size > optionalHeader.SizeOfImage || directory.VirtualAddress > optionalHeader.SizeOfImage - directory.Size)
+        return false;
+    auto& relocation = *(ImageBaseRelocation*)(image8 + directory.VirtualAddress);
+    if (relocation.SizeOfBlock == 0)
+        return false;
+
+    Relocate(image, &relocation, delta, log);
+    optionalHeader.ImageBase = uint32_t(base);
+    return true;
+}
+
 void PE::Relocate(void* image, void* reloc, size_t delta, int(*log)(const char*, ...))
 {
     if (image == nullptr || reloc == nullptr || log == nullptr)
         return;
 
     auto image8 = (uint8_t*)image;
-    auto relocation = (ImageBaseRelocation*)reloc;
-    while (relocation->SizeOfBlock) {
-        auto* types = (uint16_t*)relocation;
-        for (uint32_t i = sizeof(ImageBaseRelocation) / sizeof(uint16_t); i < relocation->SizeOfBlock / sizeof(uint16_t); ++i) {
+    OptionalHeader& optionalHeader = *(OptionalHeader*)(image8 + sizeof(int32_t) + sizeof(FileHeader));
+    size_t imageSize = optionalHeader.SizeOfImage;
+    size_t relocSize = optionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].Size;
+    auto reloc8 = (uint8_t*)reloc;
+
+    for (size_t offset = 0; relocSize - offset >= sizeof(ImageBaseRelocation); ) {
+        auto& relocation = *(ImageBaseRelocation*)(reloc8 + offset);
+        if (relocation.SizeOfBlock == 0)
+            break;
+        if (relocation.SizeOfBlock < sizeof(ImageBaseRelocation) || relocation.SizeOfBlock > relocSize - offset) {
+            log("%-12s : %08X (%08X) Invalid block", "Relocate", relocation.VirtualAddress, relocation.SizeOfBlock);
+            break;
+        }
+        offset += relocation.SizeOfBlock;
+
+        auto* types = (uint16_t*)(&relocation + 1);
+        size_t count = (relocation.SizeOfBlock - sizeof(ImageBaseRelocation)) / sizeof(uint16_t);
+        auto* page = image8 + relocation.VirtualAddress;
+
+        // A block of only HIGHLOW and ABSOLUTE entries inside the image is applied without branches
+        bool fast = (relocation.VirtualAddress < imageSize && imageSize - relocation.VirtualAddress >= 0x1000 + sizeof(uint32_t));
+        for (size_t i = 0; fast && i < count; ++i) {
+            auto type = types[i] >> 12;
+            fast = (type == IMAGE_REL_BASED_HIGHLOW || type == IMAGE_REL_BASED_ABSOLUTE);
+        }
+        if (fast) {
+            for (size_t i = 0; i < count; ++i) {
+                uint32_t mask = uint32_t(0) - uint32_t((types[i] >> 12) == IMAGE_REL_BASED_HIGHLOW);
+                uint32_t value;
+                memcpy(&value, page + (types[i] & 0x0FFF), sizeof(uint32_t));
+                value += uint32_t(delta) & mask;
+                memcpy(page + (types[i] & 0x0FFF), &value, sizeof(uint32_t));
+            }
+            continue;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
             auto type = types[i] >> 12;
             auto offset = types[i] & 0x0FFF;
-            auto address = relocation->VirtualAddress + offset;
+            size_t address = size_t(relocation.VirtualAddress) + offset;
+            size_t width = (type == IMAGE_REL_BASED_DIR64) ? sizeof(uint64_t) : (type == IMAGE_REL_BASED_HIGHLOW) ? sizeof(uint32_t) : sizeof(uint16_t);
+            if (type != IMAGE_REL_BASED_ABSOLUTE && (address >= imageSize || imageSize - address < width)) {
+                log("%-12s : %02X:%04X (%08zX) Out of range", "Relocate", type, offset, address);
+                continue;
+            }
             switch (type) {
             case IMAGE_REL_BASED_ABSOLUTE:
                 break;
-            case IMAGE_REL_BASED_HIGHLOW:
-                *(uint32_t*)(image8 + address) += delta;
+            case IMAGE_REL_BASED_HIGH: {
+                uint16_t value;
+                memcpy(&value, image8 + address, sizeof(uint16_t));
+                value += uint16_t(uint32_t(delta) >> 16);
+                memcpy(image8 + address, &value, sizeof(uint16_t));
+                break;
+            }
+            case IMAGE_REL_BASED_LOW: {
+                uint16_t value;
+                memcpy(&value, image8 + address, sizeof(uint16_t));
+                value += uint16_t(delta);
+                memcpy(image8 + address, &value, sizeof(uint16_t));
+                break;
+            }
+            case IMAGE_REL_BASED_HIGHLOW: {
+                uint32_t value;
+                memcpy(&value, image8 + address, sizeof(uint32_t));
+                value += uint32_t(delta);
+                memcpy(image8 + address, &value, sizeof(uint32_t));
+                break;
+            }
+            case IMAGE_REL_BASED_HIGHADJ: {
+                if (i + 1 >= count)
+                    break;
+                uint16_t value;
+                memcpy(&value, image8 + address, sizeof(uint16_t));
+                int32_t full = int32_t(uint32_t(value) << 16) + int16_t(types[++i]);
+                full += int32_t(delta) + 0x8000;
+                value = uint16_t(uint32_t(full) >> 16);
+                memcpy(image8 + address, &value, sizeof(uint16_t));
                 break;
+            }
+            case IMAGE_REL_BASED_DIR64: {
+                uint64_t value;
+                memcpy(&value, image8 + address, sizeof(uint64_t));
+                value += uint64_t(int64_t(delta));
+                memcpy(image8 + address, &value, sizeof(uint64_t));
+                break;
+            }
             default:
-                log("%-12s : %02X:%04X (%08X) Unknown", "Relocate", type, offset, address);
+                log("%-12s : %02X:%04X (%08zX) Unknown", "Relocate", type, offset, address);
                 break;
             }
         }
-        relocation = (ImageBaseRelocation*)((uint8_t*)relocation + relocation->SizeOfBlock);
     }
 }
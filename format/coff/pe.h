@@ -258,4 +258,5 @@ struct PE : public COFF
     static void Imports(void* image, size_t(*sym)(const char*, const char*), int(*log)(const char*, ...));
     static void Exports(void* image, void(*sym)(const char*, size_t, void*), void* sym_data);
     static void Relocate(void* image, void* reloc, size_t delta, int(*log)(const char*, ...));
+    static bool Rebase(void* image, size_t base, int(*log)(const char*, ...));
 };
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Read-only view of a whole file, a private copy where mmap is not available
+static inline uint8_t* MapFile(const char* path, size_t* size)
+{
+#if defined(_WIN32)
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+        return nullptr;
+    fseek(file, 0, SEEK_END);
+    (*size) = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    auto* data = (uint8_t*)malloc((*size) ? (*size) : 1);
+    if (data && fread(data, 1, (*size), file) != (*size)) {
+        free(data);
+        data = nullptr;
+    }
+    fclose(file);
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    (*size) = st.st_size;
+    void* data = mmap(nullptr, (*size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    return data != MAP_FAILED ? (uint8_t*)data : nullptr;
+#endif
+}
+
+static inline void UnmapFile(uint8_t* data, size_t size)
+{
+#if defined(_WIN32)
+    free(data);
+#else
+    munmap(data, size);
+#endif
+}
@@ -7,13 +7,47 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 struct allocator_t;
 struct miCPU
 {
+    // Reason returned by RunFor
+    enum
+    {
+        RUN_EXIT,
+        RUN_COUNT,
+        RUN_DEADLINE,
+        RUN_BREAKPOINT,
+        RUN_FAULT,
+    };
+
+    struct Instruction
+    {
+        struct Operand
+        {
+            int8_t type;
+            int8_t flags;
+            int8_t scale;
+            int8_t index;
+            int8_t base;
+            int64_t displacement;
+        };
+
+        size_t address;
+        uint8_t length;
+        uint8_t width;
+        uint8_t size;
+        uint8_t prefix;
+        const char* mnemonic;
+        const char* segment;
+        Operand operand[3];
+    };
+
     virtual ~miCPU() = default;
     virtual bool Initialize(allocator_t* allocator, size_t stack) = 0;
     virtual bool Run() = 0;
+    virtual int RunFor(size_t instructions, size_t microseconds, size_t* retired = nullptr) = 0;
     virtual bool Step(int type) = 0;
     virtual bool Jump(size_t address) = 0;
     virtual uint8_t* Memory(size_t base = 0, size_t size = 0) const = 0;
@@ -22,10 +56,26 @@ struct miCPU
     virtual size_t Program() const = 0;
     virtual std::string Status() const = 0;
     virtual std::string Disassemble(int count) const = 0;
+    virtual size_t Disassemble(size_t begin, size_t end, std::vector<Instruction>& instructions) const = 0;
+    virtual std::string Disassemble(const Instruction& instruction) const = 0;
 
     allocator_t* Allocator = nullptr;
     size_t BreakpointDataAddress = 0;
     size_t BreakpointDataValue = 0;
     size_t BreakpointProgram = 0;
+    std::vector<std::pair<size_t, size_t>> BreakpointDatas;
+    std::vector<size_t> BreakpointPrograms;
     size_t (*Exception)(miCPU*, size_t) = [](miCPU*, size_t) { return size_t(0); };
+
+    // Result of Effect besides the count of regions
+    enum
+    {
+        EFFECT_NONE = -1,       // deterministic, executed again on replay
+        EFFECT_UNKNOWN = -2,    // reads host state the journal cannot hold, replay stops there
+        EFFECT_EXECUTE = 0x100, // added to the count when the call allocates guest memory or returns host storage,
+                                // executed again on replay and the regions are restored over its writes
+    };
+
+    // Memory written by a call that reads host state, as up to 4 address and size pairs
+    int (*Effect)(miCPU*, size_t, size_t*) = [](miCPU*, size_t, size_t*) { return int(EFFECT_NONE); };
 };
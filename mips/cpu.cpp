@@ -8,11 +8,18 @@
 // Copyright (C) Wave Computing, Inc. All rights reserved.
 //==============================================================================
 
+#include <string.h>
+#include <chrono>
 #include "platform.h"
 #include "cpu.h"
 
-CPU::SYSTEMCALLFUNCTION CPU::SystemCallFunction;
-CPU::NATIVEFUNCTION CPU::NativeFunction;
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   include <sys/mman.h>
+#endif
+
 //------------------------------------------------------------------------------
 CPU::CPU()
     :cop0(*this)
@@ -32,10 +39,41 @@ CPU::CPU()
     // Stack
     Stack = new intptr_t[65536];
     GPR[29] = (intptr_t)&Stack[65504];
+
+    // Guest Arena
+    ArenaBase = 0;
+    ArenaMask = UINTPTR_MAX;
+    ArenaSnapshot = nullptr;
+
+    // Handler
+    SystemCallFunction = nullptr;
+    SystemCallData = nullptr;
+    NativeFunction = nullptr;
+    NativeFunctionData = nullptr;
+
+    // Native Function
+    NativeTable = nullptr;
+    NativeTableMask = 0;
+    NativeTableCount = 0;
+
+    // Block
+    BlockCache = nullptr;
+    BlockChain = nullptr;
+    DelaySlot = nullptr;
+
+    // Trace
+    TraceBuffer = nullptr;
+    TraceMask = 0;
+    TraceHead = 0;
+    Tracing.store(false, std::memory_order_relaxed);
 }
 //------------------------------------------------------------------------------
 CPU::~CPU()
 {
+    delete[] TraceBuffer;
+    FlushBlocks();
+    DestroyArena();
+    delete[] NativeTable;
     delete[] Stack;
 }
 //------------------------------------------------------------------------------
@@ -48,10 +86,14 @@ void CPU::Execute(const void* code)
         intptr_t pc = PC;
 
         // Instruction
-        Encode = *(int*)pc;
+        Encode = *(int*)Translate(pc);
         FINSTRUCTION OPCODE = tableOPCODE[opcode];
         (this->*OPCODE)();
 
+        // Trace
+        if (Tracing.load(std::memory_order_relaxed))
+            RecordTrace(pc);
+
 #if defined(_DEBUG)
         // Debug
         if (GPR[0] != 0)
@@ -64,15 +106,255 @@ void CPU::Execute(const void* code)
             PC += 4;
         }
         // Native Function
-        else if (NativeFunction)
+        else
+        {
+            CallNativeFunction();
+        }
+
+        // Exit
+        if (PC == 0)
+            break;
+    }
+}
+//------------------------------------------------------------------------------
+int CPU::RunFor(size_t instructions, size_t microseconds, size_t* retired)
+{
+    // Resume at PC, a branch and its delay slot retire as one instruction
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(microseconds);
+
+    int reason = RunCount;
+    size_t count = 0;
+    while (count < instructions)
+    {
+        // The clock is read once every 1024 instructions
+        if (microseconds && (count & 1023) == 1023 && std::chrono::steady_clock::now() >= deadline)
+        {
+            reason = RunDeadline;
+            break;
+        }
+
+        intptr_t pc = PC;
+
+        // Instruction
+        Encode = *(int*)Translate(pc);
+        FINSTRUCTION OPCODE = tableOPCODE[opcode];
+        (this->*OPCODE)();
+        count++;
+
+        // Trace
+        if (Tracing.load(std::memory_order_relaxed))
+            RecordTrace(pc);
+
+        // Not Branch and Jump
+        if (PC == pc)
+        {
+            PC += 4;
+        }
+        // Native Function
+        else
         {
-            NativeFunction(*this);
+            CallNativeFunction();
         }
 
         // Exit
         if (PC == 0)
+        {
+            reason = RunExit;
+            break;
+        }
+    }
+
+    if (retired)
+        (*retired) = count;
+    return reason;
+}
+//------------------------------------------------------------------------------
+void CPU::ExecuteBlocks(const void* code)
+{
+    if (BlockCache == nullptr)
+    {
+        BlockCache = new BLOCK*[BLOCKCACHE]{};
+    }
+
+    PC = (intptr_t)code;
+    GPR[25] = PC;
+    BLOCK* block = nullptr;
+    for (;;)
+    {
+        // Successor
+        BLOCK* next = nullptr;
+        if (block)
+        {
+            if (block->link[0] && block->link[0]->address == PC)
+                next = block->link[0];
+            else if (block->link[1] && block->link[1]->address == PC)
+                next = block->link[1];
+        }
+        if (next == nullptr)
+        {
+            // A block is compiled once, colliding blocks stay in the bucket
+            BLOCK** bucket = &BlockCache[(PC >> 2) & (BLOCKCACHE - 1)];
+            BLOCK** found = bucket;
+            while ((*found) && (*found)->address != PC)
+                found = &(*found)->bucket;
+            next = (*found);
+            if (next == nullptr)
+            {
+                next = CompileBlock(PC);
+                next->bucket = (*bucket);
+                (*bucket) = next;
+            }
+            else if (found != bucket)
+            {
+                (*found) = next->bucket;
+                next->bucket = (*bucket);
+                (*bucket) = next;
+            }
+            if (block)
+                block->link[block->link[0] ? 1 : 0] = next;
+        }
+        block = next;
+
+        // Body
+        bool transfer = false;
+        const DECODED* decoded = block->body;
+        const DECODED* terminator = block->body + block->count - 1;
+        for (; decoded != terminator; ++decoded)
+        {
+            intptr_t pc = PC;
+            Encode = decoded->encode;
+            (this->*decoded->instruction)();
+            if (Tracing.load(std::memory_order_relaxed))
+                RecordTrace(pc);
+            if (PC != pc)
+            {
+                transfer = true;
+                break;
+            }
+            PC += 4;
+        }
+
+        // Terminator with the fused delay slot
+        if (transfer == false)
+        {
+            intptr_t pc = PC;
+            Encode = terminator->encode;
+            DelaySlot = block->terminated ? &block->delaySlot : nullptr;
+            (this->*terminator->instruction)();
+            DelaySlot = nullptr;
+            if (Tracing.load(std::memory_order_relaxed))
+                RecordTrace(pc);
+            if (PC == pc)
+                PC += 4;
+            else
+                transfer = true;
+        }
+
+        // Native Function
+        if (transfer)
+        {
+            CallNativeFunction();
+        }
+
+        // Exit
+        if (PC == 0)
+            break;
+    }
+}
+//------------------------------------------------------------------------------
+void CPU::FlushBlocks()
+{
+    while (BlockChain)
+    {
+        BLOCK* block = BlockChain;
+        BlockChain = block->chain;
+        delete block;
+    }
+    delete[] BlockCache;
+    BlockCache = nullptr;
+}
+//------------------------------------------------------------------------------
+CPU::BLOCK* CPU::CompileBlock(intptr_t address)
+{
+    BLOCK* block = new BLOCK;
+    block->address = address;
+    block->link[0] = nullptr;
+    block->link[1] = nullptr;
+    block->chain = BlockChain;
+    block->bucket = nullptr;
+    block->count = 0;
+    block->terminated = false;
+    BlockChain = block;
+
+    while (block->count < BLOCKLENGTH)
+    {
+        unsigned int encode = *(unsigned int*)Translate(address);
+        block->body[block->count++] = Decode(encode);
+        address += 4;
+        if (IsTerminator(encode))
+        {
+            block->terminated = true;
+            block->delaySlot = Decode(*(unsigned int*)Translate(address));
             break;
+        }
     }
+
+    return block;
+}
+//------------------------------------------------------------------------------
+CPU::DECODED CPU::Decode(unsigned int encode)
+{
+    DECODED decoded = { encode, tableOPCODE[encode >> 26] };
+    if (decoded.instruction == &CPU::SPECIAL)
+        decoded.instruction = tableSPECIAL[encode & 0x3F];
+    else if (decoded.instruction == &CPU::REGIMM)
+        decoded.instruction = tableREGIMM[(encode >> 16) & 0x1F];
+    else if (decoded.instruction == &CPU::SPECIAL3)
+        decoded.instruction = tableSPECIAL3[encode & 0x3F];
+    return decoded;
+}
+//------------------------------------------------------------------------------
+bool CPU::IsTerminator(unsigned int encode)
+{
+    switch (encode >> 26)
+    {
+    case 000:   // SPECIAL
+        switch (encode & 0x3F)
+        {
+        case 011:   // JALR
+        case 014:   // SYSCALL
+        case 015:   // BREAK
+        case 016:   // SDBBP
+        case 060:   // TGE
+        case 061:   // TGEU
+        case 062:   // TLT
+        case 063:   // TLTU
+        case 064:   // TEQ
+        case 066:   // TNE
+            return true;
+        }
+        return false;
+    case 001:   // REGIMM
+    case 002:   // J
+    case 003:   // JAL
+    case 004:   // BEQ
+    case 005:   // BNE
+    case 006:   // POP06
+    case 007:   // POP07
+    case 010:   // POP10
+    case 020:   // COP0
+    case 021:   // COP1
+    case 022:   // COP2
+    case 026:   // POP26
+    case 027:   // POP27
+    case 030:   // POP30
+    case 062:   // BC
+    case 066:   // POP66
+    case 072:   // BALC
+    case 076:   // POP76
+        return true;
+    }
+    return false;
 }
 //------------------------------------------------------------------------------
 void CPU::BranchDelaySlot()
@@ -80,35 +362,165 @@ void CPU::BranchDelaySlot()
     unsigned int encode = Encode;
 
     // Instruction
-    Encode = *(int*)(PC + 4);
-    FINSTRUCTION OPCODE = tableOPCODE[opcode];
-    (this->*OPCODE)();
+    if (DelaySlot)
+    {
+        Encode = DelaySlot->encode;
+        (this->*DelaySlot->instruction)();
+    }
+    else
+    {
+        Encode = *(int*)Translate(PC + 4);
+        FINSTRUCTION OPCODE = tableOPCODE[opcode];
+        (this->*OPCODE)();
+    }
+
+    // Trace, the delay slot is recorded ahead of its branch
+    if (Tracing.load(std::memory_order_relaxed))
+        RecordTrace(PC + 4);
 
     Encode = encode;
 }
 //------------------------------------------------------------------------------
-void CPU::SetSystemCall(SYSTEMCALLFUNCTION systemCall)
+bool CPU::CreateArena(size_t size)
+{
+    DestroyArena();
+
+    // Power of two, followed by guard pages for accesses across the end
+    size_t power = 65536;
+    while (power < size)
+        power <<= 1;
+    size_t guard = 65536;
+#if defined(_WIN32)
+    void* arena = VirtualAlloc(nullptr, power + guard, MEM_RESERVE, PAGE_NOACCESS);
+    if (arena == nullptr)
+        return false;
+    if (VirtualAlloc(arena, power, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+    {
+        VirtualFree(arena, 0, MEM_RELEASE);
+        return false;
+    }
+#else
+    void* arena = mmap(nullptr, power + guard, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (arena == MAP_FAILED)
+        return false;
+    if (mprotect(arena, power, PROT_READ | PROT_WRITE) != 0)
+    {
+        munmap(arena, power + guard);
+        return false;
+    }
+#endif
+
+    ArenaBase = (uintptr_t)arena;
+    ArenaMask = power - 1;
+    GPR[29] = power - 256;
+    return true;
+}
+//------------------------------------------------------------------------------
+void CPU::DestroyArena()
+{
+    if (ArenaBase)
+    {
+#if defined(_WIN32)
+        VirtualFree((void*)ArenaBase, 0, MEM_RELEASE);
+#else
+        munmap((void*)ArenaBase, ArenaMask + 1 + 65536);
+#endif
+    }
+    delete[] ArenaSnapshot;
+    ArenaBase = 0;
+    ArenaMask = UINTPTR_MAX;
+    ArenaSnapshot = nullptr;
+}
+//------------------------------------------------------------------------------
+void CPU::Snapshot()
+{
+    if (ArenaBase == 0)
+        return;
+    if (ArenaSnapshot == nullptr)
+        ArenaSnapshot = new uint8_t[ArenaMask + 1];
+    memcpy(ArenaSnapshot, (void*)ArenaBase, ArenaMask + 1);
+    memcpy(SnapshotGPR, GPR, sizeof(SnapshotGPR));
+    SnapshotPC = PC;
+}
+//------------------------------------------------------------------------------
+void CPU::Reset()
+{
+    if (ArenaBase == 0 || ArenaSnapshot == nullptr)
+        return;
+    memcpy((void*)ArenaBase, ArenaSnapshot, ArenaMask + 1);
+    memcpy(GPR, SnapshotGPR, sizeof(SnapshotGPR));
+    PC = SnapshotPC;
+}
+//------------------------------------------------------------------------------
+void CPU::SetSystemCall(SYSTEMCALLFUNCTION systemCall, void* data)
 {
     SystemCallFunction = systemCall;
+    SystemCallData = data;
 }
 //------------------------------------------------------------------------------
-void CPU::SetNativeFunction(NATIVEFUNCTION nativeFunction)
+void CPU::SetNativeFunction(NATIVEFUNCTION nativeFunction, void* data)
 {
     NativeFunction = nativeFunction;
+    NativeFunctionData = data;
+}
+//------------------------------------------------------------------------------
+void CPU::SetNativeFunction(intptr_t address, NATIVEFUNCTION nativeFunction, void* data)
+{
+    if (address == 0)
+        return;
+
+    // Grow at half load
+    if ((NativeTableCount + 1) * 2 > NativeTableMask + 1)
+    {
+        NATIVEENTRY* table = NativeTable;
+        size_t count = table ? NativeTableMask + 1 : 0;
+        NativeTableMask = count ? count * 2 - 1 : 63;
+        NativeTable = new NATIVEENTRY[NativeTableMask + 1]{};
+        NativeTableCount = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (table[i].address)
+            {
+                SetNativeFunction(table[i].address, table[i].function, table[i].data);
+            }
+        }
+        delete[] table;
+    }
+
+    size_t index = (size_t(address) >> 2) * 2654435761u;
+    for (;;)
+    {
+        NATIVEENTRY& entry = NativeTable[index & NativeTableMask];
+        if (entry.address == 0)
+        {
+            entry.address = address;
+            NativeTableCount++;
+        }
+        if (entry.address == address)
+        {
+            entry.function = nativeFunction;
+            entry.data = data;
+            break;
+        }
+        index++;
+    }
 }
 //------------------------------------------------------------------------------
 void CPU::SignalException(int exception, int argument)
 {
+    if (SystemCallFunction)
+    {
+        SystemCallFunction(*this, exception, argument, SystemCallData);
+        return;
+    }
+
+    // Stop the guest without a handler
     switch (exception)
     {
     case SystemCall:
-        if (SystemCallFunction)
-        {
-            SystemCallFunction(*this, argument);
-        }
         break;
     default:
-        __builtin_trap();
+        PC = 0;
         break;
     }
 }
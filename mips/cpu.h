@@ -15,6 +15,7 @@
 #else
 #    include <stdint.h>
 #endif
+#include <atomic>
 #include "instr.h"
 #include "sysctl.h"
 #include "fpu.h"
@@ -96,24 +97,125 @@ public:
     // Stack
     intptr_t* Stack;
 
+    // Guest Arena
+    uintptr_t ArenaBase;
+    uintptr_t ArenaMask;
+    uint8_t* ArenaSnapshot;
+    intptr_t SnapshotGPR[32];
+    intptr_t SnapshotPC;
+
 public:
     CPU();
     ~CPU();
 
+public:
+    // Reason returned by RunFor
+    enum
+    {
+        RunExit,            // PC reached 0
+        RunCount,           // Instruction count retired
+        RunDeadline,        // Time slice elapsed
+    };
+
 public:
     void Execute(const void* code);
+    void ExecuteBlocks(const void* code);
+    int RunFor(size_t instructions, size_t microseconds, size_t* retired = nullptr);
+    void FlushBlocks();
     void BranchDelaySlot();
 
 public:
-    typedef void (*SYSTEMCALLFUNCTION)(CPU& cpu, unsigned int code);
-    static void SetSystemCall(SYSTEMCALLFUNCTION systemCall);
+    // Guest address to host address, identity without an arena
+    inline void* Translate(intptr_t address) const
+    {
+        return (void*)(ArenaBase + (address & ArenaMask));
+    }
+    bool CreateArena(size_t size);
+    void DestroyArena();
+    void Snapshot();
+    void Reset();
+
+public:
+    // Binary trace, one fixed-size record per retired instruction
+    struct TRACE
+    {
+        intptr_t pc;
+        unsigned int encode;
+        unsigned int reg;       // rd for SPECIAL and SPECIAL3, rt otherwise
+        intptr_t value;
+    };
+    void EnableTrace(size_t count);
+    void DisableTrace();
+    size_t ReadTrace(TRACE* records, size_t count) const;
+    static const char* Mnemonic(unsigned int encode);
+    static int FormatTrace(char* text, size_t size, const TRACE& trace);
+
+public:
+    typedef void (*SYSTEMCALLFUNCTION)(CPU& cpu, int exception, unsigned int code, void* data);
+    void SetSystemCall(SYSTEMCALLFUNCTION systemCall, void* data = nullptr);
 
-    typedef void (*NATIVEFUNCTION)(CPU& cpu);
-    static void SetNativeFunction(NATIVEFUNCTION nativeFunction);
+    typedef void (*NATIVEFUNCTION)(CPU& cpu, void* data);
+    void SetNativeFunction(NATIVEFUNCTION nativeFunction, void* data = nullptr);
+    void SetNativeFunction(intptr_t address, NATIVEFUNCTION nativeFunction, void* data = nullptr);
 
 protected:
-    static SYSTEMCALLFUNCTION SystemCallFunction;
-    static NATIVEFUNCTION NativeFunction;
+    SYSTEMCALLFUNCTION SystemCallFunction;
+    void* SystemCallData;
+    NATIVEFUNCTION NativeFunction;
+    void* NativeFunctionData;
+
+    // Native function table (open addressing)
+    struct NATIVEENTRY
+    {
+        intptr_t address;
+        NATIVEFUNCTION function;
+        void* data;
+    };
+    NATIVEENTRY* NativeTable;
+    size_t NativeTableMask;
+    size_t NativeTableCount;
+    inline const NATIVEENTRY* FindNativeFunction(intptr_t address) const
+    {
+        size_t index = (size_t(address) >> 2) * 2654435761u;
+        for (;;)
+        {
+            const NATIVEENTRY& entry = NativeTable[index & NativeTableMask];
+            if (entry.address == address)
+                return &entry;
+            if (entry.address == 0)
+                return nullptr;
+            index++;
+        }
+    }
+    // Trace ring, written only by the executing thread
+    TRACE* TraceBuffer;
+    size_t TraceMask;
+    std::atomic<size_t> TraceHead;
+    std::atomic<bool> Tracing;
+    inline void RecordTrace(intptr_t pc)
+    {
+        size_t head = TraceHead.load(std::memory_order_relaxed);
+        TRACE& trace = TraceBuffer[head & TraceMask];
+        unsigned int reg = (opcode == 000 || opcode == 037) ? rd : rt;
+        trace.pc = pc;
+        trace.encode = Encode;
+        trace.reg = reg;
+        trace.value = GPR[reg];
+        TraceHead.store(head + 1, std::memory_order_release);
+    }
+
+    inline void CallNativeFunction()
+    {
+        const NATIVEENTRY* entry = NativeTableCount ? FindNativeFunction(PC) : nullptr;
+        if (entry && entry->function)
+        {
+            entry->function(*this, entry->data);
+        }
+        else if (NativeFunction)
+        {
+            NativeFunction(*this, NativeFunctionData);
+        }
+    }
 
 public:
     enum
@@ -418,4 +520,30 @@ protected:
     static const FINSTRUCTION tableDBSHFL[4 * 8];
     static const FINSTRUCTION tableCOP0[4 * 8];
     static const FINSTRUCTION tableCOP0C0[8 * 8];
+
+protected:
+    // Basic block, the last instruction is the terminator followed by its delay slot
+    enum { BLOCKLENGTH = 64, BLOCKCACHE = 4096 };
+    struct DECODED
+    {
+        unsigned int encode;
+        FINSTRUCTION instruction;
+    };
+    struct BLOCK
+    {
+        intptr_t address;
+        BLOCK* link[2];
+        BLOCK* chain;
+        BLOCK* bucket;
+        unsigned int count;
+        bool terminated;
+        DECODED body[BLOCKLENGTH];
+        DECODED delaySlot;
+    };
+    BLOCK** BlockCache;     // Buckets of blocks, the most recent first
+    BLOCK* BlockChain;
+    const DECODED* DelaySlot;
+    BLOCK* CompileBlock(intptr_t address);
+    static DECODED Decode(unsigned int encode);
+    static bool IsTerminator(unsigned int encode);
 };
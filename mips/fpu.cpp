@@ -143,7 +143,7 @@ void FPU::LWC1()
     }
     else
     {
-        float load = *(float*)address;
+        float load = *(float*)cpu.Translate(address);
         FPR[ft].f32 = load;
     }
 }
@@ -157,7 +157,7 @@ void FPU::LDC1()
     }
     else
     {
-        double load = *(double*)address;
+        double load = *(double*)cpu.Translate(address);
         FPR[ft].f64 = load;
     }
 }
@@ -171,7 +171,7 @@ void FPU::SWC1()
     }
     else
     {
-        float& store = *(float*)address;
+        float& store = *(float*)cpu.Translate(address);
         store = FPR[ft].f32;
     }
 }
@@ -185,7 +185,7 @@ void FPU::SDC1()
     }
     else
     {
-        double& store = *(double*)address;
+        double& store = *(double*)cpu.Translate(address);
         store = FPR[ft].f64;
     }
 }
@@ -515,7 +515,7 @@ void CPU::PCREL()
 void CPU::LB()
 {
     intptr_t address = GPR[rs] + immediate;
-    signed char load = *(signed char*)address;
+    signed char load = *(signed char*)Translate(address);
     GPR[rt] = load;
     MIPS_DEBUG("LB", "GPR:%-2u[%016zX] = GPR:%-2u[%016zX] + IMM:%X", rt, GPR[rt], rs, GPR[rs], immediate);
 }
@@ -524,7 +524,7 @@ void CPU::LH()
 {
     intptr_t address = GPR[rs] + immediate;
     signed short load;
-    memcpy(&load, (void*)address, sizeof(short));
+    memcpy(&load, Translate(address), sizeof(short));
     GPR[rt] = load;
     MIPS_DEBUG("LH", "GPR:%-2u[%016zX] = GPR:%-2u[%016zX] + IMM:%X", rt, GPR[rt], rs, GPR[rs], immediate);
 }
@@ -533,7 +533,7 @@ void CPU::LW()
 {
     intptr_t address = GPR[rs] + immediate;
     signed int load;
-    memcpy(&load, (void*)address, sizeof(int));
+    memcpy(&load, Translate(address), sizeof(int));
     GPR[rt] = load;
     MIPS_DEBUG("LW", "GPR:%-2u[%016zX] = GPR:%-2u[%016zX] + IMM:%X[%016zX]", rt, GPR[rt], rs, GPR[rs], immediate, address);
 }
@@ -541,7 +541,7 @@ void CPU::LW()
 void CPU::LBU()
 {
     intptr_t address = GPR[rs] + immediate;
-    unsigned char load = *(char*)address;
+    unsigned char load = *(char*)Translate(address);
     GPR[rt] = load;
     MIPS_DEBUG("LBU", "GPR:%-2u[%016zX] = GPR:%-2u[%016zX] + IMM:%X", rt, GPR[rt], rs, GPR[rs], immediate);
 }
@@ -550,7 +550,7 @@ void CPU::LHU()
 {
     intptr_t address = GPR[rs] + immediate;
     unsigned short load;
-    memcpy(&load, (void*)address, sizeof(short));
+    memcpy(&load, Translate(address), sizeof(short));
     GPR[rt] = load;
     MIPS_DEBUG("LHU", "GPR:%-2u[%016zX] = GPR:%-2u[%016zX] + IMM:%X", rt, GPR[rt], rs, GPR[rs], immediate);
 }
@@ -560,7 +560,7 @@ void CPU::LWU()
 #if (MIPS_BITS >= 64)
     intptr_t address = GPR[rs] + immediate;
     unsigned int load;
-    memcpy(&load, (void*)address, sizeof(int));
+    memcpy(&load, Translate(address), sizeof(int));
     GPR[rt] = load;
     MIPS_DEBUG("LWU", "GPR:%-2u[%016zX] = GPR:%-2u[%016zX] + IMM:%X", rt, GPR[rt], rs, GPR[rs], immediate);
 #endif
@@ -569,7 +569,7 @@ void CPU::LWU()
 void CPU::SB()
 {
     intptr_t address = GPR[rs] + immediate;
-    char& store = *(char*)address;
+    char& store = *(char*)Translate(address);
     store = (char)GPR[rt];
     MIPS_DEBUG("SB", "GPR:%-2u[%016zX] + IMM:%X = GPR:%-2u[%016zX]", rs, GPR[rs], immediate, rt, GPR[rt]);
 }
@@ -577,14 +577,14 @@ void CPU::SB()
 void CPU::SH()
 {
     intptr_t address = GPR[rs] + immediate;
-    memcpy((void*)address, &GPR[rt], sizeof(short));
+    memcpy(Translate(address), &GPR[rt], sizeof(short));
     MIPS_DEBUG("SH", "GPR:%-2u[%016zX] + IMM:%X = GPR:%-2u[%016zX]", rs, GPR[rs], immediate, rt, GPR[rt]);
 }
 //------------------------------------------------------------------------------
 void CPU::SW()
 {
     intptr_t address = GPR[rs] + immediate;
-    memcpy((void*)address, &GPR[rt], sizeof(int));
+    memcpy(Translate(address), &GPR[rt], sizeof(int));
     MIPS_DEBUG("SW", "GPR:%-2u[%016zX] + IMM:%X = GPR:%-2u[%016zX]", rs, GPR[rs], immediate, rt, GPR[rt]);
 }
 //------------------------------------------------------------------------------
@@ -603,7 +603,7 @@ void CPU::LD()
 #if (MIPS_BITS >= 64)
     intptr_t address = GPR[rs] + immediate;
     intptr_t load;
-    memcpy (&load, (void*)address, sizeof (intptr_t));
+    memcpy (&load, Translate(address), sizeof (intptr_t));
     GPR[rt] = load;
     MIPS_DEBUG("LD", "GPR:%-2u[%016zX] = GPR:%-2u[%016zX] + IMM:%X[%016zX]", rt, GPR[rt], rs, GPR[rs], immediate, address);
 #endif
@@ -623,7 +623,7 @@ void CPU::SD()
 {
 #if (MIPS_BITS >= 64)
     intptr_t address = GPR[rs] + immediate;
-    memcpy((void*)address, &GPR[rt], sizeof (intptr_t));
+    memcpy(Translate(address), &GPR[rt], sizeof (intptr_t));
     MIPS_DEBUG("SD", "GPR:%-2u[%016zX] + IMM:%X = GPR:%-2u[%016zX]", rs, GPR[rs], immediate, rt, GPR[rt]);
 #endif
 }
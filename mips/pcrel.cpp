@@ -38,7 +38,7 @@ void CPU::LWPC()
 {
     intptr_t address = PC + (offset_19 << 2);
     int memword;
-    memcpy(&memword, (void*)address, sizeof(int));
+    memcpy(&memword, Translate(address), sizeof(int));
     GPR[rs] = memword;
     MIPS_DEBUG("LWPC", "GPR:%-2u[%016zX] = PC + IMM:%X", rs, GPR[rs], offset_19);
 }
@@ -47,7 +47,7 @@ void CPU::LWUPC()
 {
     intptr_t address = PC + (offset_19 << 2);
     unsigned int memword;
-    memcpy(&memword, (void*)address, sizeof(int));
+    memcpy(&memword, Translate(address), sizeof(int));
     GPR[rs] = memword;
     MIPS_DEBUG("LWUPC", "GPR:%-2u[%016zX] = PC + IMM:%X", rs, GPR[rs], offset_19);
 }
@@ -56,7 +56,7 @@ void CPU::LDPC()
 {
     intptr_t address = (PC & 7) + offset_18;
     intptr_t memdoubleword;
-    memcpy(&memdoubleword, (void*)address, sizeof(intptr_t));
+    memcpy(&memdoubleword, Translate(address), sizeof(intptr_t));
     GPR[rs] = memdoubleword;
     MIPS_DEBUG("LDPC", "GPR:%-2u[%016zX] = PC + IMM:%X", rs, GPR[rs], offset_18);
 }
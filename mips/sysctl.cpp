@@ -91,7 +91,7 @@ void SYSCTL::LL()
     }
     else
     {
-        int load = *(int*)address;
+        int load = *(int*)cpu.Translate(address);
         cpu.GPR[rt] = load;
     }
 }
@@ -105,7 +105,7 @@ void SYSCTL::SC()
     }
     else
     {
-        int& store = *(int*)address;
+        int& store = *(int*)cpu.Translate(address);
         store = (int)cpu.GPR[rt];
     }
 }
@@ -0,0 +1,181 @@
+//==============================================================================
+// MIPS(R) Architecture For Programmers Volume II-A: The MIPS64(R) Instruction Set Reference Manual
+//
+// Document Number: MD00087
+// Revision 6.06
+// December 15, 2016
+//
+// Copyright (C) Wave Computing, Inc. All rights reserved.
+//==============================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include "cpu.h"
+
+//------------------------------------------------------------------------------
+// Mnemonics in the layout of the opcode tables
+//------------------------------------------------------------------------------
+static const char* const nameOPCODE[8 * 8] =
+{
+    "SPECIAL",  "REGIMM",   "J",    "JAL",  "BEQ",  "BNE",  "POP06",    "POP07",
+    "POP10",    "ADDIU",    "SLTI", "SLTIU","ANDI", "ORI",  "XORI",     "AUI",
+    "COP0",     "COP1",     "COP2", "____", "____", "____", "POP26",    "POP27",
+    "POP30",    "DADDIU",   "____", "____", "____", "DAUI", "____",     "SPECIAL3",
+    "LB",       "LH",       "____", "LW",   "LBU",  "LHU",  "____",     "LWU",
+    "SB",       "SH",       "____", "SW",   "____", "____", "____",     "____",
+    "____",     "LWC1",     "BC",   "____", "____", "LDC1", "POP66",    "LD",
+    "____",     "SWC1",     "BALC", "PCREL","____", "SDC1", "POP76",    "SD",
+};
+static const char* const nameREGIMM[4 * 8] =
+{
+    "BLTZ", "BGEZ", "____", "____", "____", "____", "DAHI", "____",
+    "____", "____", "____", "____", "____", "____", "____", "____",
+    "NAL",  "BAL",  "____", "____", "____", "____", "____", "SIGRIE",
+    "____", "____", "____", "____", "____", "____", "DATI", "SYNCI",
+};
+static const char* const namePCREL[8 * 4] =
+{
+    "ADDIUPC",  "ADDIUPC",  "ADDIUPC",  "ADDIUPC",  "ADDIUPC",  "ADDIUPC",  "ADDIUPC",  "ADDIUPC",
+    "LWPC",     "LWPC",     "LWPC",     "LWPC",     "LWPC",     "LWPC",     "LWPC",     "LWPC",
+    "LWUPC",    "LWUPC",    "LWUPC",    "LWUPC",    "LWUPC",    "LWUPC",    "LWUPC",    "LWUPC",
+    "LDPC",     "LDPC",     "LDPC",     "LDPC",     "____",     "____",     "AUIPC",    "ALUIPC",
+};
+static const char* const nameSPECIAL[8 * 8] =
+{
+    "SLL",  "____", "SRL",  "SRA",  "SLLV",     "LSA",      "SRLV",     "SRAV",
+    "____", "JALR", "____", "____", "SYSCALL",  "BREAK",    "SDBBP",    "SYNC",
+    "CLZ",  "CLO",  "DCLZ", "DCLO", "DSLLV",    "DLSA",     "DSRLV",    "DSRAV",
+    "SOP3x","SOP3x","SOP3x","SOP3x","SOP3x",    "SOP3x",    "SOP3x",    "SOP3x",
+    "ADD",  "ADDU", "SUB",  "SUBU", "AND",      "OR",       "XOR",      "NOR",
+    "____", "____", "SLT",  "SLTU", "DADD",     "DADDU",    "DSUB",     "DSUBU",
+    "TGE",  "TGEU", "TLT",  "TLTU", "TEQ",      "SELEQZ",   "TNE",      "SELNEZ",
+    "DSLL", "____", "DSRL", "DSRA", "DSLL32",   "____",     "DSRL32",   "DSRA32",
+};
+static const char* const nameMULDIV[8 * 4] =
+{
+    "____", "____", "____", "____", "____", "____", "____", "____",
+    "____", "____", "____", "____", "____", "____", "____", "____",
+    "MUL",  "MULU", "DIV",  "DIVU", "DMUL", "DMULU","DDIV", "DDIVU",
+    "MUH",  "MUHU", "MOD",  "MODU", "DMUH", "DMUHU","DMOD", "DMODU",
+};
+static const char* const nameSPECIAL3[8 * 8] =
+{
+    "EXT",  "DEXTM","DEXTU","DEXT",     "INS",      "DINSM","DINSU","DINS",
+    "____", "____", "____", "____",     "____",     "____", "____", "____",
+    "____", "____", "____", "____",     "____",     "____", "____", "____",
+    "____", "____", "____", "CACHEE",   "SBE",      "SHE",  "SCE",  "SWE",
+    "BSHFL","____", "____", "PREFE",    "DBSHFL",   "CACHE","SC",   "SCD",
+    "LBUE", "LHUE", "____", "____",     "LBE",      "LHE",  "LLE",  "LWE",
+    "____", "____", "____", "____",     "____",     "PREF", "LL",   "LLD",
+    "____", "____", "____", "RDHWR",    "____",     "____", "____", "____",
+};
+static const char* const nameBSHFL[4 * 8] =
+{
+    "BITSWAP",  "____", "WSBH", "____", "____", "____", "____", "____",
+    "ALIGN",    "ALIGN","ALIGN","ALIGN","____", "____", "____", "____",
+    "SEB",      "____", "____", "____", "____", "____", "____", "____",
+    "SEH",      "____", "____", "____", "____", "____", "____", "____",
+};
+static const char* const nameDBSHFL[4 * 8] =
+{
+    "DBITSWAP", "____",     "DSBH",     "____",     "____",     "DSHD",     "____",     "____",
+    "DALIGN",   "DALIGN",   "DALIGN",   "DALIGN",   "DALIGN",   "DALIGN",   "DALIGN",   "DALIGN",
+    "____",     "____",     "____",     "____",     "____",     "____",     "____",     "____",
+    "____",     "____",     "____",     "____",     "____",     "____",     "____",     "____",
+};
+//------------------------------------------------------------------------------
+void CPU::EnableTrace(size_t count)
+{
+    // Power of two, the ring index is masked
+    size_t power = 1024;
+    while (power < count)
+        power <<= 1;
+
+    if (TraceBuffer == nullptr || TraceMask + 1 != power)
+    {
+        Tracing.store(false, std::memory_order_relaxed);
+        delete[] TraceBuffer;
+        TraceBuffer = new TRACE[power];
+        TraceMask = power - 1;
+        TraceHead.store(0, std::memory_order_release);
+    }
+
+    Tracing.store(true, std::memory_order_release);
+}
+//------------------------------------------------------------------------------
+void CPU::DisableTrace()
+{
+    // The ring is kept for ReadTrace
+    Tracing.store(false, std::memory_order_relaxed);
+}
+//------------------------------------------------------------------------------
+size_t CPU::ReadTrace(TRACE* records, size_t count) const
+{
+    if (TraceBuffer == nullptr)
+        return 0;
+
+    // Most recent records, oldest first
+    size_t head = TraceHead.load(std::memory_order_acquire);
+    size_t available = head < TraceMask + 1 ? head : TraceMask + 1;
+    if (count > available)
+        count = available;
+    size_t start = head - count;
+    for (size_t i = 0; i < count; ++i)
+    {
+        records[i] = TraceBuffer[(start + i) & TraceMask];
+    }
+
+    // The writer fills slot after & TraceMask before publishing it, so the
+    // slots of head through after may have been rewritten while copying
+    size_t after = TraceHead.load(std::memory_order_acquire);
+    size_t written = after - head + 1;
+    size_t untouched = TraceMask + 1 - count;
+    size_t torn = written > untouched ? written - untouched : 0;
+    if (torn >= count)
+        return 0;
+    if (torn)
+    {
+        count -= torn;
+        memmove(records, records + torn, count * sizeof(TRACE));
+    }
+    return count;
+}
+//------------------------------------------------------------------------------
+const char* CPU::Mnemonic(unsigned int encode)
+{
+    unsigned int function = encode & 0x3F;
+    unsigned int sa = (encode >> 6) & 0x1F;
+    unsigned int rt = (encode >> 16) & 0x1F;
+    unsigned int immediate = encode & 0xFFFF;
+
+    switch (encode >> 26)
+    {
+    case 000:   // SPECIAL
+        if (encode == 0)
+            return "NOP";
+        if (function == 002 && (encode & (1 << 21)))
+            return "ROTR";
+        if (function == 006 && sa == 1)
+            return "ROTRV";
+        if ((function & 070) == 030)
+            return nameMULDIV[(immediate & 0x7) | ((immediate >> 3) & 18)];
+        return nameSPECIAL[function];
+    case 001:   // REGIMM
+        return nameREGIMM[rt];
+    case 037:   // SPECIAL3
+        if (function == 040)
+            return nameBSHFL[sa];
+        if (function == 044)
+            return nameDBSHFL[sa];
+        return nameSPECIAL3[function];
+    case 073:   // PCREL
+        return namePCREL[rt];
+    }
+    return nameOPCODE[encode >> 26];
+}
+//------------------------------------------------------------------------------
+int CPU::FormatTrace(char* text, size_t size, const TRACE& trace)
+{
+    return snprintf(text, size, "%014zX:%08X %-10s GPR:%-2u[%016zX]", size_t(trace.pc), trace.encode, Mnemonic(trace.encode), trace.reg, size_t(trace.value));
+}
+//------------------------------------------------------------------------------
@@ -9,6 +9,9 @@
 #include <setjmp.h>
 #include <signal.h>
 #include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
 #include "riscv_cpu.h"
 
 #if defined(_UCRT)
@@ -27,35 +30,80 @@ const riscv_cpu::instruction_pointer riscv_cpu::map32[8 * 4] =
 {
     o LOAD      x LOAD_FP   x HINT  x MISC_MEM  x OP_IMM    x AUIPC x OP_IMM_32 x HINT
     x STORE     x STORE_FP  x HINT  x AMO       x OP        x LUI   x OP_32     x HINT
-    x MADD      x MSUB      x NMSUB x NMADD     x OP_FP     x HINT  x HINT      x HINT
+    x MADD      x MSUB      x NMSUB x NMADD     x OP_FP     x OP_V  x HINT      x HINT
     x BRANCH    x JALR      x HINT  x JAL       x SYSTEM    x HINT  x HINT      x HINT
 };
 //------------------------------------------------------------------------------
 #undef o
 #undef x
 //------------------------------------------------------------------------------
-static jmp_buf buf;
+#if defined(_WIN32)
+static thread_local jmp_buf buf;
 static sig_t sigsegv;
+#else
+static thread_local sigjmp_buf buf;
+static struct sigaction sigsegv;
+#endif
+static std::mutex handlerMutex;
+static int handlerCount;
 //------------------------------------------------------------------------------
-static void register_handler()
+static void signal_handler(int)
 {
-    sigsegv = signal(SIGSEGV, [](int){ longjmp(buf, 1); });
+#if defined(_WIN32)
+    // The handler is reset to SIG_DFL on delivery while other threads still rely on it
+    signal(SIGSEGV, signal_handler);
+    longjmp(buf, 1);
+#else
+    siglongjmp(buf, 1);
+#endif
 }
 //------------------------------------------------------------------------------
-static int check_handler()
+static void register_handler()
 {
-    return setjmp(buf);
+    // Shared by every thread running a cpu, the jump buffer is per thread
+    std::lock_guard<std::mutex> lock(handlerMutex);
+    if (handlerCount++ == 0)
+    {
+#if defined(_WIN32)
+        sigsegv = signal(SIGSEGV, signal_handler);
+#else
+        struct sigaction action = {};
+        action.sa_handler = signal_handler;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGSEGV, &action, &sigsegv);
+#endif
+    }
 }
 //------------------------------------------------------------------------------
+// The jump buffer must be set in the frame that runs the guest
+// The signal mask is saved too, SIGSEGV would stay blocked after the jump
+#if defined(_WIN32)
+#define check_handler() setjmp(buf)
+#else
+#define check_handler() sigsetjmp(buf, 1)
+#endif
+//------------------------------------------------------------------------------
 static void unregister_handler()
 {
-    signal(SIGSEGV, sigsegv);
+    std::lock_guard<std::mutex> lock(handlerMutex);
+    if (--handlerCount == 0)
+    {
+#if defined(_WIN32)
+        signal(SIGSEGV, sigsegv);
+#else
+        sigaction(SIGSEGV, &sigsegv, nullptr);
+#endif
+    }
 }
 //------------------------------------------------------------------------------
 riscv_cpu::riscv_cpu()
 {
     stack = new uintptr_t[8192];
 
+    arena = nullptr;
+    arenaSize = 0;
+    exitCode = 0;
+
     environmentCall = [](riscv_cpu&cpu) {};
     environmentBreakpoint = [](riscv_cpu&cpu) {};
 
@@ -64,6 +112,7 @@ riscv_cpu::riscv_cpu()
 //------------------------------------------------------------------------------
 riscv_cpu::~riscv_cpu()
 {
+    unload();
     delete[] stack;
 }
 //------------------------------------------------------------------------------
@@ -72,6 +121,7 @@ void riscv_cpu::program(const void* code, size_t size)
     format = 0;
 
     reservation = 0;
+    reservationValue = 0;
     for (int i = 0; i < 32; ++i)
     {
         x[i] = 0;
@@ -84,10 +134,45 @@ void riscv_cpu::program(const void* code, size_t size)
     }
     fcsr = 0;
 
+#if RISCV_HAVE_VECTOR
+    memset(v, 0, sizeof(v));
+    vl = 0;
+    vtype = uintptr_t(1) << (sizeof(uintptr_t) * 8 - 1);
+    vstart = 0;
+#endif
+
     begin = pc;
     end = pc + size;
+    stop = RUN_BUDGET;
+
+    instret = 0;
+    cycleBias = 0;
+    for (int i = 0; i < HPM_COUNT; ++i)
+    {
+        hpmcounter[i] = 0;
+    }
 
     x[2] = (uintptr_t)&stack[8188];
+
+#if RISCV_HAVE_JIT
+    translator.flush();
+#endif
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::attach(const riscv_cpu& hart, uintptr_t entry, uintptr_t stackPointer, uintptr_t threadPointer, uintptr_t argument)
+{
+    // Another hart of the same guest, the memory and handlers are shared,
+    // the thread pointer belongs to the new thread as with clone CLONE_SETTLS
+    program((void*)hart.begin, hart.end - hart.begin);
+    fcsr = hart.fcsr;
+    environmentCall = hart.environmentCall;
+    environmentBreakpoint = hart.environmentBreakpoint;
+
+    pc = entry;
+    x[2] = stackPointer;
+    x[3] = hart.x[3];
+    x[4] = threadPointer;
+    x[10] = argument;
 }
 //------------------------------------------------------------------------------
 bool riscv_cpu::issue()
@@ -112,7 +197,15 @@ bool riscv_cpu::issue()
         (this->*inst)();
 
         if (pc == address)
+        {
+            // A reserved encoding was not executed, pc stays on it
+            if (stop == RUN_FAULT)
+            {
+                stop = RUN_BUDGET;
+                return false;
+            }
             pc += 4;
+        }
         break;
     }
     case 5:
@@ -131,6 +224,7 @@ bool riscv_cpu::issue()
         return false;
     }
     x[0] = 0;
+    instret++;
 
     return true;
 }
@@ -143,6 +237,14 @@ bool riscv_cpu::run()
     {
         while (pc >= begin && pc < end)
         {
+#if RISCV_HAVE_JIT
+            auto block = translator.find(*this);
+            if (block)
+            {
+                block->entry(this);
+                continue;
+            }
+#endif
             if (issue() == false)
                 break;
         }
@@ -172,6 +274,69 @@ bool riscv_cpu::runOnce()
     return success;
 }
 //------------------------------------------------------------------------------
+int riscv_cpu::run(size_t budget)
+{
+    return runFor(budget, 0);
+}
+//------------------------------------------------------------------------------
+int riscv_cpu::runFor(size_t budget, size_t microseconds, size_t* retired)
+{
+    // The clock is read once every 1024 instructions, a block may retire past the boundary
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(microseconds);
+    uint64_t retiredBegin = instret;
+
+    int reason = RUN_FAULT;
+    register_handler();
+    if (check_handler() == 0)
+    {
+        reason = RUN_BUDGET;
+        stop = RUN_BUDGET;
+        size_t clock = budget & ~size_t(1023);
+        for (; budget; --budget)
+        {
+            if (microseconds && budget <= clock)
+            {
+                clock = (budget - 1) & ~size_t(1023);
+                if (std::chrono::steady_clock::now() >= deadline)
+                {
+                    reason = RUN_DEADLINE;
+                    break;
+                }
+            }
+            if (pc < begin || pc >= end)
+            {
+                reason = RUN_EXIT;
+                break;
+            }
+#if RISCV_HAVE_JIT
+            auto block = translator.find(*this);
+            if (block && block->count <= budget)
+            {
+                block->entry(this);
+                budget -= block->count - 1;
+                continue;
+            }
+#endif
+            if (issue() == false)
+            {
+                reason = RUN_FAULT;
+                break;
+            }
+            if (stop != RUN_BUDGET)
+            {
+                reason = (pc >= begin && pc < end) ? stop : RUN_EXIT;
+                stop = RUN_BUDGET;
+                break;
+            }
+        }
+    }
+    unregister_handler();
+
+    if (retired)
+        (*retired) = size_t(instret - retiredBegin);
+    return reason;
+}
+//------------------------------------------------------------------------------
 void riscv_cpu::fclearexcept()
 {
     feclearexcept(FE_ALL_EXCEPT);
@@ -194,6 +359,7 @@ void riscv_cpu::HINT()
 //------------------------------------------------------------------------------
 void riscv_cpu::LOAD()
 {
+    hpmcounter[HPM_LOAD]++;
     switch (funct3)
     {
     case 0b000: return LB();
@@ -209,9 +375,12 @@ void riscv_cpu::LOAD()
 //------------------------------------------------------------------------------
 void riscv_cpu::LOAD_FP()
 {
+    hpmcounter[HPM_LOAD]++;
     switch (funct3)
     {
-    case 0b000: return HINT();
+#if RISCV_HAVE_VECTOR
+    case 0b000: return VLOAD();
+#endif
     case 0b001: return HINT();
 #if RISCV_HAVE_SINGLE
     case 0b010: return FLW();
@@ -220,9 +389,12 @@ void riscv_cpu::LOAD_FP()
     case 0b011: return FLD();
 #endif
     case 0b100: return HINT();
-    case 0b101: return HINT();
-    case 0b110: return HINT();
-    case 0b111: return HINT();
+#if RISCV_HAVE_VECTOR
+    case 0b101: return VLOAD();
+    case 0b110: return VLOAD();
+    case 0b111: return VLOAD();
+#endif
+    default:    return HINT();
     }
 }
 //------------------------------------------------------------------------------
@@ -246,15 +418,35 @@ void riscv_cpu::OP_IMM()
     switch (funct3)
     {
     case 0b000: return ADDI();
-    case 0b001: return SLLI();
+    case 0b001: switch (funct7 >> 1)
+                {
+                case 0b000000: return SLLI();
+                case 0b001010: return BSETI();
+                case 0b010010: return BCLRI();
+                case 0b011010: return BINVI();
+                case 0b011000: switch (rs2)
+                               {
+                               case 0b00000: return CLZ();
+                               case 0b00001: return CTZ();
+                               case 0b00010: return CPOP();
+                               case 0b00100: return SEXT_B();
+                               case 0b00101: return SEXT_H();
+                               default:      return HINT();
+                               }
+                default:       return HINT();
+                }
     case 0b010: return SLTI();
     case 0b011: return SLTIU();
     case 0b100: return XORI();
-    case 0b101: switch (funct7)
+    case 0b101: switch (funct7 >> 1)
                 {
-                case 0b0000000: return SRLI();
-                case 0b0100000: return SRAI();
-                default:        return HINT();
+                case 0b000000: return SRLI();
+                case 0b010000: return SRAI();
+                case 0b010010: return BEXTI();
+                case 0b011000: return RORI();
+                case 0b001010: return (immI() == 0b001010000111) ? ORC_B() : HINT();
+                case 0b011010: return (immI() == (sizeof(uintptr_t) == 8 ? 0b011010111000 : 0b011010011000)) ? REV8() : HINT();
+                default:       return HINT();
                 }
     case 0b110: return ORI();
     case 0b111: return ANDI();
@@ -266,7 +458,19 @@ void riscv_cpu::OP_IMM_32()
     switch (funct3)
     {
     case 0b000: return ADDIW();
-    case 0b001: return SLLIW();
+    case 0b001: switch (funct7 >> 1)
+                {
+                case 0b000000: return SLLIW();
+                case 0b000010: return SLLI_UW();
+                case 0b011000: switch (rs2)
+                               {
+                               case 0b00000: return CLZW();
+                               case 0b00001: return CTZW();
+                               case 0b00010: return CPOPW();
+                               default:      return HINT();
+                               }
+                default:       return HINT();
+                }
     case 0b010: return HINT();
     case 0b011: return HINT();
     case 0b100: return HINT();
@@ -274,6 +478,7 @@ void riscv_cpu::OP_IMM_32()
                 {
                 case 0b0000000: return SRLIW();
                 case 0b0100000: return SRAIW();
+                case 0b0110000: return RORIW();
                 default:        return HINT();
                 }
     case 0b110: return HINT();
@@ -283,6 +488,7 @@ void riscv_cpu::OP_IMM_32()
 //------------------------------------------------------------------------------
 void riscv_cpu::STORE()
 {
+    hpmcounter[HPM_STORE]++;
     switch (funct3)
     {
     case 0b000: return SB();
@@ -298,9 +504,12 @@ void riscv_cpu::STORE()
 //------------------------------------------------------------------------------
 void riscv_cpu::STORE_FP()
 {
+    hpmcounter[HPM_STORE]++;
     switch (funct3)
     {
-    case 0b000: return HINT();
+#if RISCV_HAVE_VECTOR
+    case 0b000: return VSTORE();
+#endif
     case 0b001: return HINT();
 #if RISCV_HAVE_SINGLE
     case 0b010: return FSW();
@@ -309,9 +518,12 @@ void riscv_cpu::STORE_FP()
     case 0b011: return FSD();
 #endif
     case 0b100: return HINT();
-    case 0b101: return HINT();
-    case 0b110: return HINT();
-    case 0b111: return HINT();
+#if RISCV_HAVE_VECTOR
+    case 0b101: return VSTORE();
+    case 0b110: return VSTORE();
+    case 0b111: return VSTORE();
+#endif
+    default:    return HINT();
     }
 }
 //------------------------------------------------------------------------------
@@ -386,14 +598,98 @@ void riscv_cpu::OP()
                     case 0b111: return REMU();
                     }
                     break;
+    case 0b0000101: switch (funct3)
+                    {
+                    case 0b000: return HINT();
+                    case 0b001: return HINT();
+                    case 0b010: return HINT();
+                    case 0b011: return HINT();
+                    case 0b100: return MIN();
+                    case 0b101: return MINU();
+                    case 0b110: return MAX();
+                    case 0b111: return MAXU();
+                    }
+                    break;
+    case 0b0000100: switch (funct3)
+                    {
+                    case 0b000: return HINT();
+                    case 0b001: return HINT();
+                    case 0b010: return HINT();
+                    case 0b011: return HINT();
+                    case 0b100: return (sizeof(uintptr_t) == 4 && rs2 == 0) ? ZEXT_H() : HINT();
+                    case 0b101: return HINT();
+                    case 0b110: return HINT();
+                    case 0b111: return HINT();
+                    }
+                    break;
+    case 0b0010000: switch (funct3)
+                    {
+                    case 0b000: return HINT();
+                    case 0b001: return HINT();
+                    case 0b010: return SH1ADD();
+                    case 0b011: return HINT();
+                    case 0b100: return SH2ADD();
+                    case 0b101: return HINT();
+                    case 0b110: return SH3ADD();
+                    case 0b111: return HINT();
+                    }
+                    break;
+    case 0b0010100: switch (funct3)
+                    {
+                    case 0b000: return HINT();
+                    case 0b001: return BSET();
+                    case 0b010: return HINT();
+                    case 0b011: return HINT();
+                    case 0b100: return HINT();
+                    case 0b101: return HINT();
+                    case 0b110: return HINT();
+                    case 0b111: return HINT();
+                    }
+                    break;
     case 0b0100000: switch (funct3)
                     {
                     case 0b000: return SUB();
                     case 0b001: return HINT();
                     case 0b010: return HINT();
                     case 0b011: return HINT();
-                    case 0b100: return HINT();
+                    case 0b100: return XNOR();
                     case 0b101: return SRA();
+                    case 0b110: return ORN();
+                    case 0b111: return ANDN();
+                    }
+                    break;
+    case 0b0100100: switch (funct3)
+                    {
+                    case 0b000: return HINT();
+                    case 0b001: return BCLR();
+                    case 0b010: return HINT();
+                    case 0b011: return HINT();
+                    case 0b100: return HINT();
+                    case 0b101: return BEXT();
+                    case 0b110: return HINT();
+                    case 0b111: return HINT();
+                    }
+                    break;
+    case 0b0110000: switch (funct3)
+                    {
+                    case 0b000: return HINT();
+                    case 0b001: return ROL();
+                    case 0b010: return HINT();
+                    case 0b011: return HINT();
+                    case 0b100: return HINT();
+                    case 0b101: return ROR();
+                    case 0b110: return HINT();
+                    case 0b111: return HINT();
+                    }
+                    break;
+    case 0b0110100: switch (funct3)
+                    {
+                    case 0b000: return HINT();
+                    case 0b001: return BINV();
+                    case 0b010: return HINT();
+                    case 0b011: return HINT();
+                    case 0b100: return HINT();
+                    case 0b101: return HINT();
                     case 0b110: return HINT();
                     case 0b111: return HINT();
                     }
@@ -430,6 +726,30 @@ void riscv_cpu::OP_32()
                     case 0b111: return REMUW();
                     }
                     break;
+    case 0b0000100: switch (funct3)
+                    {
+                    case 0b000: return ADD_UW();
+                    case 0b001: return HINT();
+                    case 0b010: return HINT();
+                    case 0b011: return HINT();
+                    case 0b100: return (rs2 == 0) ? ZEXT_H() : HINT();
+                    case 0b101: return HINT();
+                    case 0b110: return HINT();
+                    case 0b111: return HINT();
+                    }
+                    break;
+    case 0b0010000: switch (funct3)
+                    {
+                    case 0b000: return HINT();
+                    case 0b001: return HINT();
+                    case 0b010: return SH1ADD_UW();
+                    case 0b011: return HINT();
+                    case 0b100: return SH2ADD_UW();
+                    case 0b101: return HINT();
+                    case 0b110: return SH3ADD_UW();
+                    case 0b111: return HINT();
+                    }
+                    break;
     case 0b0100000: switch (funct3)
                     {
                     case 0b000: return SUBW();
@@ -442,12 +762,25 @@ void riscv_cpu::OP_32()
                     case 0b111: return HINT();
                     }
                     break;
+    case 0b0110000: switch (funct3)
+                    {
+                    case 0b000: return HINT();
+                    case 0b001: return ROLW();
+                    case 0b010: return HINT();
+                    case 0b011: return HINT();
+                    case 0b100: return HINT();
+                    case 0b101: return RORW();
+                    case 0b110: return HINT();
+                    case 0b111: return HINT();
+                    }
+                    break;
     default:        return HINT();
     }
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::MADD()
 {
+    hpmcounter[HPM_FLOAT]++;
     switch (fmt)
     {
 #if RISCV_HAVE_SINGLE
@@ -463,6 +796,7 @@ void riscv_cpu::MADD()
 //------------------------------------------------------------------------------
 void riscv_cpu::MSUB()
 {
+    hpmcounter[HPM_FLOAT]++;
     switch (fmt)
     {
 #if RISCV_HAVE_SINGLE
@@ -478,6 +812,7 @@ void riscv_cpu::MSUB()
 //------------------------------------------------------------------------------
 void riscv_cpu::NMSUB()
 {
+    hpmcounter[HPM_FLOAT]++;
     switch (fmt)
     {
 #if RISCV_HAVE_SINGLE
@@ -493,6 +828,7 @@ void riscv_cpu::NMSUB()
 //------------------------------------------------------------------------------
 void riscv_cpu::NMADD()
 {
+    hpmcounter[HPM_FLOAT]++;
     switch (fmt)
     {
 #if RISCV_HAVE_SINGLE
@@ -508,6 +844,7 @@ void riscv_cpu::NMADD()
 //------------------------------------------------------------------------------
 void riscv_cpu::OP_FP()
 {
+    hpmcounter[HPM_FLOAT]++;
     switch (fmt)
     {
 #if RISCV_HAVE_SINGLE
@@ -649,8 +986,27 @@ void riscv_cpu::OP_FP()
     }
 }
 //------------------------------------------------------------------------------
+void riscv_cpu::OP_V()
+{
+    switch (funct3)
+    {
+#if RISCV_HAVE_VECTOR
+    case 0b000: return OPIVV();
+    case 0b001: return OPFVV();
+    case 0b010: return OPMVV();
+    case 0b011: return OPIVI();
+    case 0b100: return OPIVX();
+    case 0b101: return OPFVF();
+    case 0b110: return OPMVX();
+    case 0b111: return OPCFG();
+#endif
+    default:    return HINT();
+    }
+}
+//------------------------------------------------------------------------------
 void riscv_cpu::BRANCH()
 {
+    hpmcounter[HPM_BRANCH]++;
     switch (funct3)
     {
     case 0b000: return BEQ();
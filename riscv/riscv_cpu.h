@@ -9,6 +9,7 @@
 
 #include <stddef.h>
 #include "riscv_instruction.h"
+#include "riscv_jit.h"
 
 struct riscv_cpu : public riscv_instruction
 {
@@ -16,14 +17,31 @@ struct riscv_cpu : public riscv_instruction
     ~riscv_cpu();
 
     void program(const void* code, size_t size);
+    void attach(const riscv_cpu& hart, uintptr_t entry, uintptr_t stackPointer, uintptr_t threadPointer, uintptr_t argument);
+    bool load(const char* path, int argc, const char* argv[], int envc, const char* envp[], size_t stackSize = 1048576);
+    void unload();
 
     bool issue();
     bool run();
     bool runOnce();
 
+    // Reason returned by run(budget) and runFor
+    enum
+    {
+        RUN_EXIT,       // pc left [begin, end)
+        RUN_BUDGET,     // budget exhausted
+        RUN_DEADLINE,   // time slice elapsed
+        RUN_ECALL,      // after environmentCall
+        RUN_EBREAK,     // after environmentBreakpoint
+        RUN_FAULT,      // memory fault, unsupported instruction length or reserved vector register group
+    };
+    int run(size_t budget);
+    int runFor(size_t budget, size_t microseconds, size_t* retired = nullptr);
+
 public:
     uintptr_t* stack;
     uintptr_t reservation;
+    uint64_t reservationValue;
     register_t x[32];
     uintptr_t pc;
 
@@ -32,13 +50,43 @@ public:
     void fclearexcept();
     void ftestexcept();
 
+#if RISCV_HAVE_VECTOR
+    enum { VLEN = 256, VLENB = VLEN / 8 };
+    alignas(VLENB) uint8_t v[32][VLENB];
+    uintptr_t vl;
+    uintptr_t vtype;
+    uintptr_t vstart;
+#endif
+
     uintptr_t begin;
     uintptr_t end;
+    int stop;
+
+    // Counters, cycle reads as instret plus cycleBias
+    enum { HPM_LOAD = 3, HPM_STORE, HPM_BRANCH, HPM_TAKEN, HPM_FLOAT, HPM_COUNT };
+    uint64_t instret;
+    uint64_t cycleBias;
+    uint64_t hpmcounter[HPM_COUNT];
+
+    // Guest arena of the loaded ELF
+    uint8_t* arena;
+    size_t arenaSize;
+    int exitCode;
 
     // Environment Call and Breakpoints
     void (*environmentCall)(riscv_cpu& cpu);
     void (*environmentBreakpoint)(riscv_cpu& cpu);
 
+#if RISCV_HAVE_JIT
+    // Hot blocks, run and runFor enter them in place of the interpreter
+    riscv_jit translator;
+#endif
+
+protected:
+    // Reservation shared by all harts, LR acquires it and SC releases it
+    void reserve(uintptr_t address, uint64_t value);
+    bool release(uintptr_t address);
+
 protected:
     typedef void instruction();
     typedef void (riscv_cpu::*instruction_pointer)();
@@ -99,6 +147,52 @@ protected:
     instruction SRLW;
     instruction SRAW;
 
+    // RV32/RV64 Zba Standard Extension
+    instruction SH1ADD;
+    instruction SH2ADD;
+    instruction SH3ADD;
+    instruction ADD_UW;
+    instruction SH1ADD_UW;
+    instruction SH2ADD_UW;
+    instruction SH3ADD_UW;
+    instruction SLLI_UW;
+
+    // RV32/RV64 Zbb Standard Extension
+    instruction ANDN;
+    instruction ORN;
+    instruction XNOR;
+    instruction CLZ;
+    instruction CLZW;
+    instruction CTZ;
+    instruction CTZW;
+    instruction CPOP;
+    instruction CPOPW;
+    instruction MAX;
+    instruction MAXU;
+    instruction MIN;
+    instruction MINU;
+    instruction SEXT_B;
+    instruction SEXT_H;
+    instruction ZEXT_H;
+    instruction ROL;
+    instruction ROLW;
+    instruction ROR;
+    instruction RORI;
+    instruction RORIW;
+    instruction RORW;
+    instruction ORC_B;
+    instruction REV8;
+
+    // RV32/RV64 Zbs Standard Extension
+    instruction BCLR;
+    instruction BCLRI;
+    instruction BEXT;
+    instruction BEXTI;
+    instruction BINV;
+    instruction BINVI;
+    instruction BSET;
+    instruction BSETI;
+
     // RV32/RV64 Zifencei Standard Extension
     instruction FENCE_I;
 
@@ -223,6 +317,18 @@ protected:
     instruction FCVT_D_LU;
     instruction FMV_D_X;
 
+    // RV64V Standard Extension
+    instruction VLOAD;
+    instruction VSTORE;
+    instruction OPIVV;
+    instruction OPFVV;
+    instruction OPMVV;
+    instruction OPIVI;
+    instruction OPIVX;
+    instruction OPFVF;
+    instruction OPMVX;
+    instruction OPCFG;
+
     // Opcode
     instruction HINT;
     instruction LOAD;
@@ -240,6 +346,7 @@ protected:
     instruction NMSUB;
     instruction NMADD;
     instruction OP_FP;
+    instruction OP_V;
     instruction BRANCH;
     instruction SYSTEM;
 
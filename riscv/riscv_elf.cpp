@@ -0,0 +1,207 @@
+//==============================================================================
+// RISC-V ELF psABI Specification
+// Document Version 1.0
+// November 30, 2022
+//==============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "riscv_cpu.h"
+#include "libelf/elf.h"
+#include "format/mapfile.h"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+#define PT_LOAD         1
+
+#define AT_NULL         0
+#define AT_PHDR         3
+#define AT_PHENT        4
+#define AT_PHNUM        5
+#define AT_PAGESZ       6
+#define AT_ENTRY        9
+#define AT_RANDOM       25
+
+static const size_t pageSize = 4096;
+
+//------------------------------------------------------------------------------
+static uint8_t* map_arena(uintptr_t hint, size_t size)
+{
+#if defined(_WIN32)
+    return (uint8_t*)calloc(1, size);
+#else
+    void* arena = mmap((void*)hint, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return arena != MAP_FAILED ? (uint8_t*)arena : nullptr;
+#endif
+}
+//------------------------------------------------------------------------------
+static void unmap_arena(uint8_t* arena, size_t size)
+{
+#if defined(_WIN32)
+    free(arena);
+#else
+    munmap(arena, size);
+#endif
+}
+//------------------------------------------------------------------------------
+bool riscv_cpu::load(const char* path, int argc, const char* argv[], int envc, const char* envp[], size_t stackSize)
+{
+    unload();
+
+    size_t size = 0;
+    uint8_t* file = MapFile(path, &size);
+    if (file == nullptr)
+        return false;
+
+    bool success = false;
+    elf_t elf = {};
+    if (elf_newFile(file, size, &elf) == 0)
+    {
+        // Guest address range, a segment outside the file fails the load
+        uintptr_t low = UINTPTR_MAX;
+        uintptr_t high = 0;
+        bool valid = true;
+        size_t count = elf_getNumProgramHeaders(&elf);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (elf_getProgramHeaderType(&elf, i) != PT_LOAD)
+                continue;
+            uintptr_t vaddr = elf_getProgramHeaderVaddr(&elf, i);
+            size_t fileOffset = elf_getProgramHeaderOffset(&elf, i);
+            size_t filesz = elf_getProgramHeaderFileSize(&elf, i);
+            size_t memsz = elf_getProgramHeaderMemorySize(&elf, i);
+            if (fileOffset > size || size - fileOffset < filesz || filesz > memsz)
+                valid = false;
+            if (low > vaddr)
+                low = vaddr;
+            if (high < vaddr + memsz)
+                high = vaddr + memsz;
+        }
+        low &= ~uintptr_t(pageSize - 1);
+        high = (high + pageSize - 1) & ~uintptr_t(pageSize - 1);
+        stackSize = (stackSize + pageSize - 1) & ~uintptr_t(pageSize - 1);
+
+        // argv, envp, the random bytes, the 7 auxv pairs and the alignment must fit the stack
+        size_t stackUsed = 16 + (1 + argc + 1 + envc + 1 + 7 * 2) * sizeof(uintptr_t) + 15;
+        for (int i = 0; i < argc; ++i)
+            stackUsed += strlen(argv[i]) + 1;
+        for (int i = 0; i < envc; ++i)
+            stackUsed += strlen(envp[i]) + 1;
+        if (stackUsed > stackSize)
+            valid = false;
+
+        // The arena is placed at the linked address when the host allows it
+        if (valid && low < high && (arena = map_arena(low, high - low + stackSize)) != nullptr)
+        {
+            arenaSize = high - low + stackSize;
+            uintptr_t offset = (uintptr_t)arena - low;
+
+            // Segments are copied straight from the file mapping, only the bss is cleared
+            uintptr_t phdr = 0;
+            uintptr_t phoff = (elf.elfClass == ELFCLASS64) ? ((Elf64_Ehdr*)file)->e_phoff : ((Elf32_Ehdr*)file)->e_phoff;
+            uintptr_t phentsize = (elf.elfClass == ELFCLASS64) ? ((Elf64_Ehdr*)file)->e_phentsize : ((Elf32_Ehdr*)file)->e_phentsize;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (elf_getProgramHeaderType(&elf, i) != PT_LOAD)
+                    continue;
+                uintptr_t vaddr = elf_getProgramHeaderVaddr(&elf, i);
+                size_t fileOffset = elf_getProgramHeaderOffset(&elf, i);
+                size_t filesz = elf_getProgramHeaderFileSize(&elf, i);
+                size_t memsz = elf_getProgramHeaderMemorySize(&elf, i);
+                memcpy((void*)(vaddr + offset), file + fileOffset, filesz);
+                memset((void*)(vaddr + offset + filesz), 0, memsz - filesz);
+                if (phoff >= fileOffset && phoff < fileOffset + filesz)
+                    phdr = vaddr + offset + (phoff - fileOffset);
+            }
+
+            uintptr_t entry = elf_getEntryPoint(&elf) + offset;
+            program((void*)arena, high - low);
+            pc = entry;
+
+            // Strings
+            uint8_t* top = arena + arenaSize;
+            auto push = [&](const void* data, size_t length) -> uintptr_t
+            {
+                top -= length;
+                memcpy(top, data, length);
+                return (uintptr_t)top;
+            };
+            std::vector<uintptr_t> strings(argc + envc);
+            for (int i = 0; i < argc; ++i)
+                strings[i] = push(argv[i], strlen(argv[i]) + 1);
+            for (int i = 0; i < envc; ++i)
+                strings[argc + i] = push(envp[i], strlen(envp[i]) + 1);
+            uint8_t random[16];
+            for (uint8_t& value : random)
+                value = uint8_t(rand());
+            uintptr_t randomAddress = push(random, sizeof(random));
+
+            // argc | argv[] | NULL | envp[] | NULL | auxv[] | AT_NULL
+            uintptr_t auxv[] =
+            {
+                AT_PHDR,    phdr,
+                AT_PHENT,   phentsize,
+                AT_PHNUM,   count,
+                AT_PAGESZ,  pageSize,
+                AT_ENTRY,   entry,
+                AT_RANDOM,  randomAddress,
+                AT_NULL,    0,
+            };
+            size_t words = 1 + argc + 1 + envc + 1 + sizeof(auxv) / sizeof(uintptr_t);
+            top = (uint8_t*)(((uintptr_t)top - words * sizeof(uintptr_t)) & ~uintptr_t(15));
+            uintptr_t* sp = (uintptr_t*)top;
+            *sp++ = argc;
+            for (int i = 0; i < argc; ++i)
+                *sp++ = strings[i];
+            *sp++ = 0;
+            for (int i = 0; i < envc; ++i)
+                *sp++ = strings[argc + i];
+            *sp++ = 0;
+            memcpy(sp, auxv, sizeof(auxv));
+
+            x[2] = (uintptr_t)top;
+            x[10] = argc;
+            x[11] = (uintptr_t)top + sizeof(uintptr_t);
+
+            // Linux system calls exit and exit_group stop the run
+            exitCode = 0;
+            environmentCall = [](riscv_cpu& cpu)
+            {
+                switch (cpu.x[17].u)
+                {
+                case 93:
+                case 94:
+                    cpu.exitCode = cpu.x[10].s32;
+                    cpu.pc = 0;
+                    break;
+                case 64:
+                    cpu.x[10] = fwrite((void*)cpu.x[11].u, 1, cpu.x[12].u, cpu.x[10].u == 2 ? stderr : stdout);
+                    break;
+                default:
+                    cpu.x[10] = uintptr_t(-38);
+                    break;
+                }
+            };
+
+            success = true;
+        }
+    }
+
+    UnmapFile(file, size);
+    return success;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::unload()
+{
+    if (arena)
+    {
+        unmap_arena(arena, arenaSize);
+    }
+    arena = nullptr;
+    arenaSize = 0;
+}
+//------------------------------------------------------------------------------
@@ -11,6 +11,7 @@
 
 #define RISCV_HAVE_SINGLE   1
 #define RISCV_HAVE_DOUBLE   0
+#define RISCV_HAVE_VECTOR   1
 
 struct riscv_instruction
 {
@@ -0,0 +1,520 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include <string.h>
+#include "riscv_cpu.h"
+
+#if RISCV_HAVE_JIT
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// Guest registers stay in riscv_cpu, RDI holds the cpu and RAX, RCX, RDX and XMM0 are scratch
+#define RAX             0
+#define RCX             1
+#define RDX             2
+
+//------------------------------------------------------------------------------
+static void emit(std::vector<uint8_t>& code, std::initializer_list<uint8_t> bytes)
+{
+    code.insert(code.end(), bytes);
+}
+//------------------------------------------------------------------------------
+static void emit32(std::vector<uint8_t>& code, uint32_t value)
+{
+    emit(code, { uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16), uint8_t(value >> 24) });
+}
+//------------------------------------------------------------------------------
+static void emit64(std::vector<uint8_t>& code, uint64_t value)
+{
+    emit32(code, uint32_t(value));
+    emit32(code, uint32_t(value >> 32));
+}
+//------------------------------------------------------------------------------
+// op reg, [base + displacement], the base is RDI for the cpu fields and RAX for guest memory
+static void operand(std::vector<uint8_t>& code, bool wide, std::initializer_list<uint8_t> op, int reg, int base, int32_t displacement)
+{
+    if (wide)
+        code.push_back(0x48);
+    emit(code, op);
+    code.push_back(0b10000000 | (reg & 7) << 3 | base);
+    emit32(code, displacement);
+}
+//------------------------------------------------------------------------------
+static void field(std::vector<uint8_t>& code, bool wide, std::initializer_list<uint8_t> op, int reg, int32_t displacement)
+{
+    operand(code, wide, op, reg, 0b111, displacement);
+}
+//------------------------------------------------------------------------------
+static void memory(std::vector<uint8_t>& code, bool wide, std::initializer_list<uint8_t> op, int reg, int32_t displacement)
+{
+    operand(code, wide, op, reg, RAX, displacement);
+}
+//------------------------------------------------------------------------------
+riscv_jit::~riscv_jit()
+{
+    if (cache == nullptr)
+        return;
+#if defined(_WIN32)
+    VirtualFree(cache, 0, MEM_RELEASE);
+#else
+    munmap(cache, CODE_SIZE);
+#endif
+}
+//------------------------------------------------------------------------------
+const riscv_jit::block* riscv_jit::find(riscv_cpu& cpu)
+{
+    if (blocks.empty())
+        blocks.resize(BLOCK_CACHE);
+
+    auto& block = blocks[(cpu.pc >> 2) % BLOCK_CACHE];
+    if (block.address != cpu.pc)
+    {
+        block.address = cpu.pc;
+        block.hits = 0;
+        block.count = 0;
+        block.entry = nullptr;
+    }
+    if (block.entry)
+        return &block;
+
+    // A block is translated once, when it becomes hot
+    if (++block.hits != BLOCK_HOT)
+        return nullptr;
+    return translate(block, cpu) ? &block : nullptr;
+}
+//------------------------------------------------------------------------------
+void riscv_jit::flush()
+{
+    for (auto& block : blocks)
+    {
+        block.address = 0;
+        block.hits = 0;
+        block.count = 0;
+        block.entry = nullptr;
+    }
+    cacheUsed = 0;
+}
+//------------------------------------------------------------------------------
+bool riscv_jit::translate(block& block, riscv_cpu& cpu)
+{
+    auto offset = [&](const void* field) { return int32_t((uint8_t*)field - (uint8_t*)&cpu); };
+    auto x = [&](int index) { return offset(&cpu.x[index]); };
+    auto f = [&](int index) { return offset(&cpu.f[index]); };
+    int32_t pc = offset(&cpu.pc);
+    int32_t fcsr = offset(&cpu.fcsr);
+    int32_t instret = offset(&cpu.instret);
+    auto hpmcounter = [&](int index) { return offset(&cpu.hpmcounter[index]); };
+
+    auto& code = buffer;
+    code.clear();
+#if defined(_WIN32)
+    emit(code, { 0x57, 0x48, 0x89, 0xCF });                             // PUSH RDI / MOV RDI, RCX
+#endif
+    emit(code, { 0x50 });                                               // PUSH RAX, scratch for MXCSR
+
+    uintptr_t address = block.address;
+    uint32_t count = 0;
+    uint32_t counters[riscv_cpu::HPM_COUNT] = {};
+    bool ended = false;
+    while (ended == false && count < BLOCK_INSTRUCTIONS && address >= cpu.begin && address + 4 <= cpu.end)
+    {
+        riscv_instruction inst;
+        inst.format = *(uint32_t*)address;
+        if ((inst.format & 0b11) != 0b11 || (inst.format & 0b11100) == 0b11100)
+            break;
+
+        int rd = inst.rd;
+        int rs1 = inst.rs1;
+        int rs2 = inst.rs2;
+        uintptr_t next = address + 4;
+        size_t before = code.size();
+        bool supported = true;
+        int counter = 0;
+
+        // The pc is kept exact for a memory fault inside the block
+        auto fault = [&]()
+        {
+            emit(code, { 0x48, 0xB9 });                                 // MOV RCX, address
+            emit64(code, address);
+            field(code, true, { 0x89 }, RCX, pc);                       // MOV [pc], RCX
+        };
+        auto result = [&](int reg)
+        {
+            if (rd != 0)
+                field(code, true, { 0x89 }, reg, x(rd));                // MOV [x rd], reg
+        };
+
+        switch (inst.opcode >> 2)
+        {
+        case 0b01101:   // LUI
+            if (rd != 0)
+            {
+                field(code, true, { 0xC7 }, 0, x(rd));                  // MOV [x rd], imm32
+                emit32(code, inst.simmU());
+            }
+            break;
+        case 0b00101:   // AUIPC
+            emit(code, { 0x48, 0xB8 });                                 // MOV RAX, pc + imm
+            emit64(code, address + inst.simmU());
+            result(RAX);
+            break;
+        case 0b00100:   // OP_IMM
+        {
+            int shamt = inst.immI() & 0x3F;
+            int shift = inst.funct7 >> 1;
+            field(code, true, { 0x8B }, RAX, x(rs1));                   // MOV RAX, [x rs1]
+            switch (inst.funct3)
+            {
+            case 0b000: emit(code, { 0x48, 0x05 }); emit32(code, inst.simmI());     break;  // ADDI
+            case 0b100: emit(code, { 0x48, 0x35 }); emit32(code, inst.simmI());     break;  // XORI
+            case 0b110: emit(code, { 0x48, 0x0D }); emit32(code, inst.simmI());     break;  // ORI
+            case 0b111: emit(code, { 0x48, 0x25 }); emit32(code, inst.simmI());     break;  // ANDI
+            case 0b010:
+            case 0b011:     // SLTI / SLTIU
+                emit(code, { 0x31, 0xC9, 0x48, 0x3D });                 // XOR ECX, ECX / CMP RAX, imm32
+                emit32(code, inst.simmI());
+                emit(code, { 0x0F, uint8_t(inst.funct3 == 0b010 ? 0x9C : 0x92), 0xC1 });   // SETL / SETB CL
+                emit(code, { 0x48, 0x89, 0xC8 });                       // MOV RAX, RCX
+                break;
+            case 0b001:     // SLLI
+                supported = (shift == 0b000000);
+                emit(code, { 0x48, 0xC1, 0xE0, uint8_t(shamt) });
+                break;
+            case 0b101:     // SRLI / SRAI
+                supported = (shift == 0b000000 || shift == 0b010000);
+                emit(code, { 0x48, 0xC1, uint8_t(shift ? 0xF8 : 0xE8), uint8_t(shamt) });
+                break;
+            }
+            result(RAX);
+            break;
+        }
+        case 0b00110:   // OP_IMM_32
+        {
+            int shamt = inst.rs2;
+            field(code, false, { 0x8B }, RAX, x(rs1));                  // MOV EAX, [x rs1]
+            switch (inst.funct3)
+            {
+            case 0b000:     // ADDIW
+                emit(code, { 0x05 });
+                emit32(code, inst.simmI());
+                break;
+            case 0b001:     // SLLIW
+                supported = (inst.funct7 == 0b0000000);
+                emit(code, { 0xC1, 0xE0, uint8_t(shamt) });
+                break;
+            case 0b101:     // SRLIW / SRAIW
+                supported = (inst.funct7 == 0b0000000 || inst.funct7 == 0b0100000);
+                emit(code, { 0xC1, uint8_t(inst.funct7 ? 0xF8 : 0xE8), uint8_t(shamt) });
+                break;
+            default:
+                supported = false;
+                break;
+            }
+            emit(code, { 0x48, 0x63, 0xC0 });                           // MOVSXD RAX, EAX
+            result(RAX);
+            break;
+        }
+        case 0b01100:   // OP
+        {
+            int reg = RAX;
+            field(code, true, { 0x8B }, RAX, x(rs1));                   // MOV RAX, [x rs1]
+            switch (inst.funct7 << 3 | inst.funct3)
+            {
+            case 0b0000000000: field(code, true, { 0x03 }, RAX, x(rs2));    break;  // ADD
+            case 0b0100000000: field(code, true, { 0x2B }, RAX, x(rs2));    break;  // SUB
+            case 0b0000000100: field(code, true, { 0x33 }, RAX, x(rs2));    break;  // XOR
+            case 0b0000000110: field(code, true, { 0x0B }, RAX, x(rs2));    break;  // OR
+            case 0b0000000111: field(code, true, { 0x23 }, RAX, x(rs2));    break;  // AND
+            case 0b0000001000: field(code, true, { 0x0F, 0xAF }, RAX, x(rs2));  break;  // MUL
+            case 0b0000001001: field(code, true, { 0xF7 }, 5, x(rs2)); reg = RDX;   break;  // MULH
+            case 0b0000001011: field(code, true, { 0xF7 }, 4, x(rs2)); reg = RDX;   break;  // MULHU
+            case 0b0000000010:
+            case 0b0000000011:  // SLT / SLTU
+                emit(code, { 0x31, 0xC9 });                             // XOR ECX, ECX
+                field(code, true, { 0x3B }, RAX, x(rs2));               // CMP RAX, [x rs2]
+                emit(code, { 0x0F, uint8_t(inst.funct3 == 0b010 ? 0x9C : 0x92), 0xC1 });   // SETL / SETB CL
+                reg = RCX;
+                break;
+            case 0b0000000001:  // SLL
+            case 0b0000000101:  // SRL
+            case 0b0100000101:  // SRA
+                field(code, true, { 0x8B }, RCX, x(rs2));               // MOV RCX, [x rs2]
+                emit(code, { 0x48, 0xD3, uint8_t(inst.funct3 == 0b001 ? 0xE0 : inst.funct7 ? 0xF8 : 0xE8) });
+                break;
+            default:
+                supported = false;
+                break;
+            }
+            result(reg);
+            break;
+        }
+        case 0b01110:   // OP_32
+        {
+            field(code, false, { 0x8B }, RAX, x(rs1));                  // MOV EAX, [x rs1]
+            switch (inst.funct7 << 3 | inst.funct3)
+            {
+            case 0b0000000000: field(code, false, { 0x03 }, RAX, x(rs2));   break;  // ADDW
+            case 0b0100000000: field(code, false, { 0x2B }, RAX, x(rs2));   break;  // SUBW
+            case 0b0000001000: field(code, false, { 0x0F, 0xAF }, RAX, x(rs2)); break;  // MULW
+            case 0b0000000001:  // SLLW
+            case 0b0000000101:  // SRLW
+            case 0b0100000101:  // SRAW
+                field(code, true, { 0x8B }, RCX, x(rs2));               // MOV RCX, [x rs2]
+                emit(code, { 0xD3, uint8_t(inst.funct3 == 0b001 ? 0xE0 : inst.funct7 ? 0xF8 : 0xE8) });
+                break;
+            default:
+                supported = false;
+                break;
+            }
+            emit(code, { 0x48, 0x63, 0xC0 });                           // MOVSXD RAX, EAX
+            result(RAX);
+            break;
+        }
+        case 0b00000:   // LOAD
+        {
+            fault();
+            field(code, true, { 0x8B }, RAX, x(rs1));                   // MOV RAX, [x rs1]
+            int32_t displacement = inst.simmI();
+            switch (inst.funct3)
+            {
+            case 0b000: memory(code, true, { 0x0F, 0xBE }, RAX, displacement);  break;  // LB
+            case 0b001: memory(code, true, { 0x0F, 0xBF }, RAX, displacement);  break;  // LH
+            case 0b010: memory(code, true, { 0x63 }, RAX, displacement);        break;  // LW
+            case 0b011: memory(code, true, { 0x8B }, RAX, displacement);        break;  // LD
+            case 0b100: memory(code, false, { 0x0F, 0xB6 }, RAX, displacement); break;  // LBU
+            case 0b101: memory(code, false, { 0x0F, 0xB7 }, RAX, displacement); break;  // LHU
+            case 0b110: memory(code, false, { 0x8B }, RAX, displacement);       break;  // LWU
+            default:    supported = false;                                      break;
+            }
+            result(RAX);
+            counter = riscv_cpu::HPM_LOAD;
+            break;
+        }
+        case 0b01000:   // STORE
+        {
+            fault();
+            field(code, true, { 0x8B }, RAX, x(rs1));                   // MOV RAX, [x rs1]
+            field(code, true, { 0x8B }, RCX, x(rs2));                   // MOV RCX, [x rs2]
+            int32_t displacement = inst.simmS();
+            switch (inst.funct3)
+            {
+            case 0b000: memory(code, false, { 0x88 }, RCX, displacement);       break;  // SB
+            case 0b001: memory(code, false, { 0x66, 0x89 }, RCX, displacement); break;  // SH
+            case 0b010: memory(code, false, { 0x89 }, RCX, displacement);       break;  // SW
+            case 0b011: memory(code, true, { 0x89 }, RCX, displacement);        break;  // SD
+            default:    supported = false;                                      break;
+            }
+            counter = riscv_cpu::HPM_STORE;
+            break;
+        }
+#if RISCV_HAVE_SINGLE
+        case 0b00001:   // LOAD_FP
+            supported = (inst.funct3 == 0b010);
+            fault();
+            field(code, true, { 0x8B }, RAX, x(rs1));                   // MOV RAX, [x rs1]
+            memory(code, false, { 0x8B }, RCX, inst.simmI());           // FLW: MOV ECX, [RAX+imm]
+            field(code, false, { 0x89 }, RCX, f(rd));                   // MOV [f rd], ECX
+            counter = riscv_cpu::HPM_LOAD;
+            break;
+        case 0b01001:   // STORE_FP
+            supported = (inst.funct3 == 0b010);
+            fault();
+            field(code, true, { 0x8B }, RAX, x(rs1));                   // MOV RAX, [x rs1]
+            field(code, false, { 0x8B }, RCX, f(rs2));                  // MOV ECX, [f rs2]
+            memory(code, false, { 0x89 }, RCX, inst.simmS());           // FSW: MOV [RAX+imm], ECX
+            counter = riscv_cpu::HPM_STORE;
+            break;
+        case 0b10100:   // OP_FP
+            if (inst.fmt != 0b00)
+            {
+                supported = false;
+                break;
+            }
+            switch (inst.funct5)
+            {
+            case 0b00000:   // FADD.S
+            case 0b00001:   // FSUB.S
+            case 0b00010:   // FMUL.S
+            case 0b00011:   // FDIV.S
+            case 0b01011:   // FSQRT.S
+            {
+                static const uint8_t op[] = { 0x58, 0x5C, 0x59, 0x5E };
+                uint8_t operation = (inst.funct5 == 0b01011) ? 0x51 : op[inst.funct5];
+                emit(code, { 0x0F, 0xAE, 0x1C, 0x24 });                 // STMXCSR [RSP]
+                emit(code, { 0x83, 0x24, 0x24, 0xC0 });                 // AND DWORD [RSP], ~0x3F
+                emit(code, { 0x0F, 0xAE, 0x14, 0x24 });                 // LDMXCSR [RSP]
+                if (operation == 0x51)
+                {
+                    field(code, false, { 0xF3, 0x0F, 0x51 }, 0, f(rs1));    // SQRTSS XMM0, [f rs1]
+                }
+                else
+                {
+                    field(code, false, { 0xF3, 0x0F, 0x10 }, 0, f(rs1));    // MOVSS XMM0, [f rs1]
+                    field(code, false, { 0xF3, 0x0F, operation }, 0, f(rs2));
+                }
+
+                // fflags is nv dz of uf nx, MXCSR has IE at bit 0, ZE 2, OE 3, UE 4 and PE 5
+                emit(code, { 0x0F, 0xAE, 0x1C, 0x24 });                 // STMXCSR [RSP]
+                emit(code, { 0x8B, 0x04, 0x24, 0x31, 0xC9 });           // MOV EAX, [RSP] / XOR ECX, ECX
+                for (uint8_t bit : { 0, 2, 3, 4, 5 })
+                {
+                    emit(code, { 0x0F, 0xBA, 0xE0, bit, 0x11, 0xC9 });  // BT EAX, bit / ADC ECX, ECX
+                }
+                field(code, false, { 0x8B }, RAX, fcsr);                // MOV EAX, [fcsr]
+                emit(code, { 0x83, 0xE0, 0xE0, 0x09, 0xC8 });           // AND EAX, ~0x1F / OR EAX, ECX
+                field(code, false, { 0x89 }, RAX, fcsr);                // MOV [fcsr], EAX
+
+                // NaN results are canonical
+                emit(code, { 0x0F, 0x2E, 0xC0, 0x7B, 0x09 });           // UCOMISS XMM0, XMM0 / JNP
+                emit(code, { 0xB8, 0x00, 0x00, 0xC0, 0x7F });           // MOV EAX, 0x7FC00000
+                emit(code, { 0x66, 0x0F, 0x6E, 0xC0 });                 // MOVD XMM0, EAX
+                field(code, false, { 0xF3, 0x0F, 0x11 }, 0, f(rd));     // MOVSS [f rd], XMM0
+                break;
+            }
+            case 0b11100:   // FMV.X.W
+                supported = (inst.funct3 == 0b000);
+                field(code, true, { 0x63 }, RAX, f(rs1));               // MOVSXD RAX, [f rs1]
+                result(RAX);
+                break;
+            case 0b11110:   // FMV.W.X
+                supported = (inst.funct3 == 0b000);
+                field(code, false, { 0x8B }, RAX, x(rs1));              // MOV EAX, [x rs1]
+                field(code, false, { 0x89 }, RAX, f(rd));               // MOV [f rd], EAX
+                break;
+            default:
+                supported = false;
+                break;
+            }
+            counter = riscv_cpu::HPM_FLOAT;
+            break;
+#endif
+        case 0b00011:   // MISC_MEM
+            supported = (inst.funct3 == 0b000);                         // FENCE
+            break;
+        case 0b11011:   // JAL
+            if (rd != 0)
+            {
+                emit(code, { 0x48, 0xB8 });                             // MOV RAX, pc + 4
+                emit64(code, next);
+                result(RAX);
+            }
+            emit(code, { 0x48, 0xB8 });                                 // MOV RAX, target
+            emit64(code, address + inst.simmJ());
+            field(code, true, { 0x89 }, RAX, pc);                       // MOV [pc], RAX
+            ended = true;
+            break;
+        case 0b11001:   // JALR
+            field(code, true, { 0x8B }, RAX, x(rs1));                   // MOV RAX, [x rs1]
+            emit(code, { 0x48, 0x05 });                                 // ADD RAX, imm32
+            emit32(code, inst.simmI());
+            if (rd != 0)
+            {
+                emit(code, { 0x48, 0xB9 });                             // MOV RCX, pc + 4
+                emit64(code, next);
+                result(RCX);
+            }
+            field(code, true, { 0x89 }, RAX, pc);                       // MOV [pc], RAX
+            ended = true;
+            break;
+        case 0b11000:   // BRANCH
+        {
+            static const uint8_t condition[8] = { 0x4, 0x5, 0, 0, 0xC, 0xD, 0x2, 0x3 };
+            if (inst.funct3 == 0b010 || inst.funct3 == 0b011)
+            {
+                supported = false;
+                break;
+            }
+            field(code, true, { 0x8B }, RAX, x(rs1));                   // MOV RAX, [x rs1]
+            field(code, true, { 0x3B }, RAX, x(rs2));                   // CMP RAX, [x rs2]
+            emit(code, { 0x48, 0xB8 });                                 // MOV RAX, pc + 4
+            emit64(code, next);
+            emit(code, { uint8_t(0x70 | (condition[inst.funct3] ^ 1)), 10 + 7 });  // Jcc not taken
+            emit(code, { 0x48, 0xB8 });                                 // MOV RAX, target
+            emit64(code, address + inst.simmB());
+            field(code, true, { 0xFF }, 0, hpmcounter(riscv_cpu::HPM_TAKEN));  // INC [taken]
+            field(code, true, { 0x89 }, RAX, pc);                       // MOV [pc], RAX
+            counter = riscv_cpu::HPM_BRANCH;
+            ended = true;
+            break;
+        }
+        default:
+            supported = false;
+            break;
+        }
+
+        // The block ends before the first instruction left to the interpreter
+        if (supported == false)
+        {
+            code.resize(before);
+            ended = false;
+            break;
+        }
+        counters[counter]++;
+        address = next;
+        count++;
+    }
+
+    // Entering a block costs about as much as interpreting a couple of instructions
+    if (count < BLOCK_MINIMUM)
+        return false;
+
+    if (ended == false)
+    {
+        emit(code, { 0x48, 0xB8 });                                     // MOV RAX, address
+        emit64(code, address);
+        field(code, true, { 0x89 }, RAX, pc);                           // MOV [pc], RAX
+    }
+    auto retire = [&](int32_t counter, uint32_t value)
+    {
+        if (value == 0)
+            return;
+        field(code, true, { 0x81 }, 0, counter);                        // ADD [counter], value
+        emit32(code, value);
+    };
+    retire(instret, count);
+    for (int i = riscv_cpu::HPM_LOAD; i < riscv_cpu::HPM_COUNT; ++i)
+    {
+        retire(hpmcounter(i), counters[i]);
+    }
+    emit(code, { 0x59 });                                               // POP RCX
+#if defined(_WIN32)
+    emit(code, { 0x5F });                                               // POP RDI
+#endif
+    emit(code, { 0xC3 });                                               // RET
+
+    if (cache == nullptr)
+    {
+#if defined(_WIN32)
+        cache = (uint8_t*)VirtualAlloc(nullptr, CODE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+        void* memory = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        cache = (memory != MAP_FAILED) ? (uint8_t*)memory : nullptr;
+#endif
+        if (cache == nullptr)
+            return false;
+    }
+
+    // A full code cache is dropped as a whole
+    uintptr_t begin = block.address;
+    if (CODE_SIZE - cacheUsed < code.size())
+        flush();
+
+    memcpy(cache + cacheUsed, code.data(), code.size());
+    block.address = begin;
+    block.hits = BLOCK_HOT;
+    block.count = count;
+    block.entry = (riscv_jit::code*)(cache + cacheUsed);
+    cacheUsed = (cacheUsed + code.size() + 15) & ~size_t(15);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+#endif
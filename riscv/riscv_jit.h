@@ -0,0 +1,55 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#if !defined(RISCV_HAVE_JIT)
+#if defined(__x86_64__) || defined(_M_X64)
+#define RISCV_HAVE_JIT      1
+#else
+#define RISCV_HAVE_JIT      0
+#endif
+#endif
+
+struct riscv_cpu;
+
+struct riscv_jit
+{
+    enum { BLOCK_CACHE = 4096, BLOCK_HOT = 64, BLOCK_MINIMUM = 2, BLOCK_INSTRUCTIONS = 64 };
+    enum { CODE_SIZE = 4194304 };
+
+    typedef void code(riscv_cpu* cpu);
+
+    // Translated guest block, dropped by flush when the guest runs FENCE.I
+    struct block
+    {
+        uintptr_t address;
+        uint32_t hits;
+        uint32_t count;
+        code* entry;
+    };
+
+    riscv_jit() = default;
+    riscv_jit(const riscv_jit&) = delete;
+    riscv_jit& operator=(const riscv_jit&) = delete;
+    ~riscv_jit();
+
+    const block* find(riscv_cpu& cpu);
+    void flush();
+
+protected:
+    bool translate(block& block, riscv_cpu& cpu);
+
+    std::vector<block> blocks;
+    std::vector<uint8_t> buffer;
+    uint8_t* cache = nullptr;
+    size_t cacheUsed = 0;
+};
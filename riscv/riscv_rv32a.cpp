@@ -5,57 +5,64 @@
 // December 13, 2019
 //==============================================================================
 
+#include <atomic>
 #include "riscv_cpu.h"
 
+//------------------------------------------------------------------------------
+// Reservation owners indexed by doubleword, a hart loses its reservation when
+// another hart does LR on the same slot, and SC still compares the loaded value
+//------------------------------------------------------------------------------
+static std::atomic<uintptr_t> reservationTable[4096];
+//------------------------------------------------------------------------------
+void riscv_cpu::reserve(uintptr_t address, uint64_t value)
+{
+    reservation = address;
+    reservationValue = value;
+    reservationTable[(address >> 3) % 4096].store((uintptr_t)this, std::memory_order_release);
+}
+//------------------------------------------------------------------------------
+bool riscv_cpu::release(uintptr_t address)
+{
+    bool reserved = (reservation == address);
+    reservation = 0;
+    uintptr_t owner = (uintptr_t)this;
+    return reserved && reservationTable[(address >> 3) % 4096].compare_exchange_strong(owner, 0, std::memory_order_acq_rel);
+}
 //------------------------------------------------------------------------------
 void riscv_cpu::LR_W()
 {
+    uintptr_t address = x[rs1].u;
     switch (funct7 & 0b11)
     {
     case 0b00:
     case 0b01:
-        x[rd].u = __atomic_load_n((int32_t*)x[rs1].u, __ATOMIC_RELAXED);
-        reservation = x[rs1].u;
+        x[rd].u = __atomic_load_n((int32_t*)address, __ATOMIC_RELAXED);
         break;
     case 0b10:
     case 0b11:
-        x[rd].u = __atomic_load_n((int32_t*)x[rs1].u, __ATOMIC_ACQUIRE);
-        reservation = x[rs1].u;
+        x[rd].u = __atomic_load_n((int32_t*)address, __ATOMIC_ACQUIRE);
         break;
     }
+    reserve(address, x[rd].u);
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::SC_W()
 {
+    uintptr_t address = x[rs1].u;
+    int32_t expected = int32_t(reservationValue);
+    bool success = release(address);
     switch (funct7 & 0b11)
     {
     case 0b00:
     case 0b10:
-        if (reservation == x[rs1].u)
-        {
-            __atomic_store_n((int32_t*)x[rs1].u, x[rs2].s32, __ATOMIC_RELAXED);
-            reservation = 0;
-            x[rd].u = 0;
-        }
-        else
-        {
-            x[rd].u = 1;
-        }
+        success = success && __atomic_compare_exchange_n((int32_t*)address, &expected, x[rs2].s32, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
         break;
     case 0b01:
     case 0b11:
-        if (reservation == x[rs1].u)
-        {
-            __atomic_store_n((int32_t*)x[rs1].u, x[rs2].s32, __ATOMIC_RELEASE);
-            reservation = 0;
-            x[rd].u = 0;
-        }
-        else
-        {
-            x[rd].u = 1;
-        }
+        success = success && __atomic_compare_exchange_n((int32_t*)address, &expected, x[rs2].s32, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
         break;
     }
+    x[rd].u = success ? 0 : 1;
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::AMOSWAP_W()
@@ -37,6 +37,7 @@ void riscv_cpu::BEQ()
     if (x[rs1].u == x[rs2].u)
     {
         pc = pc + simmB();
+        hpmcounter[HPM_TAKEN]++;
     }
 }
 //------------------------------------------------------------------------------
@@ -45,6 +46,7 @@ void riscv_cpu::BNE()
     if (x[rs1].u != x[rs2].u)
     {
         pc = pc + simmB();
+        hpmcounter[HPM_TAKEN]++;
     }
 }
 //------------------------------------------------------------------------------
@@ -53,6 +55,7 @@ void riscv_cpu::BLT()
     if (x[rs1].s < x[rs2].s)
     {
         pc = pc + simmB();
+        hpmcounter[HPM_TAKEN]++;
     }
 }
 //------------------------------------------------------------------------------
@@ -61,6 +64,7 @@ void riscv_cpu::BGE()
     if (x[rs1].s >= x[rs2].s)
     {
         pc = pc + simmB();
+        hpmcounter[HPM_TAKEN]++;
     }
 }
 //------------------------------------------------------------------------------
@@ -69,6 +73,7 @@ void riscv_cpu::BLTU()
     if (x[rs1].u < x[rs2].u)
     {
         pc = pc + simmB();
+        hpmcounter[HPM_TAKEN]++;
     }
 }
 //------------------------------------------------------------------------------
@@ -77,6 +82,7 @@ void riscv_cpu::BGEU()
     if (x[rs1].u >= x[rs2].u)
     {
         pc = pc + simmB();
+        hpmcounter[HPM_TAKEN]++;
     }
 }
 //------------------------------------------------------------------------------
@@ -223,10 +229,12 @@ void riscv_cpu::FENCE()
 void riscv_cpu::ECALL()
 {
     environmentCall(*this);
+    stop = RUN_ECALL;
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::EBREAK()
 {
     environmentBreakpoint(*this);
+    stop = RUN_EBREAK;
 }
 //------------------------------------------------------------------------------
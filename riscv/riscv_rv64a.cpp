@@ -10,52 +10,38 @@
 //------------------------------------------------------------------------------
 void riscv_cpu::LR_D()
 {
+    uintptr_t address = x[rs1].u;
     switch (funct7 & 0b11)
     {
     case 0b00:
     case 0b01:
-        x[rd].u = __atomic_load_n((int64_t*)x[rs1].u, __ATOMIC_RELAXED);
-        reservation = x[rs1].u;
+        x[rd].u = __atomic_load_n((int64_t*)address, __ATOMIC_RELAXED);
         break;
     case 0b10:
     case 0b11:
-        x[rd].u = __atomic_load_n((int64_t*)x[rs1].u, __ATOMIC_ACQUIRE);
-        reservation = x[rs1].u;
+        x[rd].u = __atomic_load_n((int64_t*)address, __ATOMIC_ACQUIRE);
         break;
     }
+    reserve(address, x[rd].u);
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::SC_D()
 {
+    uintptr_t address = x[rs1].u;
+    int64_t expected = int64_t(reservationValue);
+    bool success = release(address);
     switch (funct7 & 0b11)
     {
     case 0b00:
     case 0b10:
-        if (reservation == x[rs1].u)
-        {
-            __atomic_store_n((int64_t*)x[rs1].u, x[rs2].s64, __ATOMIC_RELAXED);
-            reservation = 0;
-            x[rd].u = 0;
-        }
-        else
-        {
-            x[rd].u = 1;
-        }
+        success = success && __atomic_compare_exchange_n((int64_t*)address, &expected, x[rs2].s64, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
         break;
     case 0b01:
     case 0b11:
-        if (reservation == x[rs1].u)
-        {
-            __atomic_store_n((int64_t*)x[rs1].u, x[rs2].s64, __ATOMIC_RELEASE);
-            reservation = 0;
-            x[rd].u = 0;
-        }
-        else
-        {
-            x[rd].u = 1;
-        }
+        success = success && __atomic_compare_exchange_n((int64_t*)address, &expected, x[rs2].s64, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
         break;
     }
+    x[rd].u = success ? 0 : 1;
 }
 //------------------------------------------------------------------------------
 void riscv_cpu::AMOSWAP_D()
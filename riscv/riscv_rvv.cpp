@@ -0,0 +1,728 @@
+//==============================================================================
+// RISC-V "V" Vector Extension
+// Version 1.0
+// September 20, 2021
+//==============================================================================
+
+#include <limits>
+#include <math.h>
+#include <string.h>
+#include <type_traits>
+#include "riscv_cpu.h"
+
+#if RISCV_HAVE_VECTOR
+//------------------------------------------------------------------------------
+// Register groups are contiguous in v[], so an operand of LMUL registers is a
+// plain array of VLMAX elements. The unmasked loops below are left simple for
+// the host compiler to turn into SSE / AVX / NEON.
+//------------------------------------------------------------------------------
+static inline bool mask(const riscv_cpu& cpu, size_t i)
+{
+    return (cpu.v[0][i >> 3] >> (i & 7)) & 1;
+}
+//------------------------------------------------------------------------------
+// EMUL = (EEW / SEW) * LMUL, a fraction takes one register, 0 when vill is set
+//------------------------------------------------------------------------------
+static uintptr_t emul(const riscv_cpu& cpu, size_t eew)
+{
+    if (cpu.vtype >> (sizeof(uintptr_t) * 8 - 1))
+        return 0;
+    intptr_t vlmul = int32_t(cpu.vtype << 29) >> 29;
+    intptr_t shift = __builtin_ctzll(eew) - intptr_t((cpu.vtype >> 3) & 0b111) + vlmul;
+    return shift <= 0 ? 1 : uintptr_t(1) << shift;
+}
+//------------------------------------------------------------------------------
+static uintptr_t lmul(const riscv_cpu& cpu)
+{
+    return emul(cpu, size_t(1) << ((cpu.vtype >> 3) & 0b111));
+}
+//------------------------------------------------------------------------------
+// A group must be 1, 2, 4 or 8 registers and start at a multiple of its size,
+// so it never runs past v31. Other encodings are reserved and stop the cpu.
+//------------------------------------------------------------------------------
+static bool group(riscv_cpu& cpu, uintptr_t size, uintptr_t a, uintptr_t b = 0, uintptr_t c = 0)
+{
+    if (size - 1 < 8 && (size & (size - 1)) == 0 && ((a | b | c) & (size - 1)) == 0)
+        return true;
+    cpu.stop = riscv_cpu::RUN_FAULT;
+    return false;
+}
+//------------------------------------------------------------------------------
+template<typename F>
+static void integers(uintptr_t vtype, F f)
+{
+    switch ((vtype >> 3) & 0b111)
+    {
+    case 0b000: return f(uint8_t());
+    case 0b001: return f(uint16_t());
+    case 0b010: return f(uint32_t());
+    case 0b011: return f(uint64_t());
+    }
+}
+//------------------------------------------------------------------------------
+template<typename F>
+static void floats(uintptr_t vtype, F f)
+{
+    switch ((vtype >> 3) & 0b111)
+    {
+    case 0b010: return f(float());
+    case 0b011: return f(double());
+    }
+}
+//------------------------------------------------------------------------------
+template<typename T, typename OP>
+static void binary(riscv_cpu& cpu, bool vector, T scalar, OP op)
+{
+    if (group(cpu, lmul(cpu), cpu.rd, cpu.rs2, vector ? cpu.rs1 : 0) == false)
+        return;
+    T* d = (T*)cpu.v[cpu.rd];
+    const T* a = (T*)cpu.v[cpu.rs2];
+    const T* b = (T*)cpu.v[cpu.rs1];
+    size_t vl = cpu.vl;
+    if (cpu.funct7 & 1)
+    {
+        if (vector)
+        {
+            for (size_t i = 0; i < vl; ++i)
+                d[i] = op(a[i], b[i]);
+        }
+        else
+        {
+            for (size_t i = 0; i < vl; ++i)
+                d[i] = op(a[i], scalar);
+        }
+        return;
+    }
+    for (size_t i = 0; i < vl; ++i)
+    {
+        if (mask(cpu, i))
+            d[i] = op(a[i], vector ? b[i] : scalar);
+    }
+}
+//------------------------------------------------------------------------------
+template<typename T, typename OP>
+static void ternary(riscv_cpu& cpu, bool vector, T scalar, OP op)
+{
+    if (group(cpu, lmul(cpu), cpu.rd, cpu.rs2, vector ? cpu.rs1 : 0) == false)
+        return;
+    T* d = (T*)cpu.v[cpu.rd];
+    const T* a = (T*)cpu.v[cpu.rs2];
+    const T* b = (T*)cpu.v[cpu.rs1];
+    size_t vl = cpu.vl;
+    bool vm = cpu.funct7 & 1;
+    for (size_t i = 0; i < vl; ++i)
+    {
+        if (vm || mask(cpu, i))
+            d[i] = op(d[i], a[i], vector ? b[i] : scalar);
+    }
+}
+//------------------------------------------------------------------------------
+template<typename T, typename OP>
+static void compare(riscv_cpu& cpu, bool vector, T scalar, OP op)
+{
+    if (group(cpu, lmul(cpu), cpu.rs2, vector ? cpu.rs1 : 0) == false)
+        return;
+    uint8_t result[riscv_cpu::VLENB];
+    memcpy(result, cpu.v[cpu.rd], sizeof(result));
+    const T* a = (T*)cpu.v[cpu.rs2];
+    const T* b = (T*)cpu.v[cpu.rs1];
+    size_t vl = cpu.vl;
+    bool vm = cpu.funct7 & 1;
+    for (size_t i = 0; i < vl; ++i)
+    {
+        if (vm == false && mask(cpu, i) == false)
+            continue;
+        uint8_t bit = uint8_t(1 << (i & 7));
+        if (op(a[i], vector ? b[i] : scalar))
+            result[i >> 3] |= bit;
+        else
+            result[i >> 3] &= ~bit;
+    }
+    memcpy(cpu.v[cpu.rd], result, sizeof(result));
+}
+//------------------------------------------------------------------------------
+template<typename T, typename OP>
+static void reduce(riscv_cpu& cpu, OP op)
+{
+    if (group(cpu, lmul(cpu), cpu.rs2) == false)
+        return;
+    const T* a = (T*)cpu.v[cpu.rs2];
+    size_t vl = cpu.vl;
+    bool vm = cpu.funct7 & 1;
+    if (vl == 0)
+        return;
+    T result = ((T*)cpu.v[cpu.rs1])[0];
+    for (size_t i = 0; i < vl; ++i)
+    {
+        if (vm || mask(cpu, i))
+            result = op(result, a[i]);
+    }
+    ((T*)cpu.v[cpu.rd])[0] = result;
+}
+//------------------------------------------------------------------------------
+template<typename T>
+static void merge(riscv_cpu& cpu, bool vector, T scalar)
+{
+    if (group(cpu, lmul(cpu), cpu.rd, cpu.rs2, vector ? cpu.rs1 : 0) == false)
+        return;
+    T* d = (T*)cpu.v[cpu.rd];
+    const T* a = (T*)cpu.v[cpu.rs2];
+    const T* b = (T*)cpu.v[cpu.rs1];
+    size_t vl = cpu.vl;
+    bool vm = cpu.funct7 & 1;
+    for (size_t i = 0; i < vl; ++i)
+    {
+        T value = vector ? b[i] : scalar;
+        d[i] = (vm || mask(cpu, i)) ? value : a[i];
+    }
+}
+//------------------------------------------------------------------------------
+template<typename D, typename S, typename OP>
+static void unary(riscv_cpu& cpu, OP op)
+{
+    if (group(cpu, lmul(cpu), cpu.rd, cpu.rs2) == false)
+        return;
+    uint8_t* d = cpu.v[cpu.rd];
+    const uint8_t* a = cpu.v[cpu.rs2];
+    size_t vl = cpu.vl;
+    bool vm = cpu.funct7 & 1;
+    for (size_t i = 0; i < vl; ++i)
+    {
+        if (vm == false && mask(cpu, i) == false)
+            continue;
+        S source;
+        memcpy(&source, a + i * sizeof(S), sizeof(S));
+        D result = op(source);
+        memcpy(d + i * sizeof(D), &result, sizeof(D));
+    }
+}
+//------------------------------------------------------------------------------
+template<typename U>
+static U mulhu(U a, U b)
+{
+    if constexpr (sizeof(U) < sizeof(uint64_t))
+    {
+        return U((uint64_t(a) * uint64_t(b)) >> (sizeof(U) * 8));
+    }
+    else
+    {
+        uint64_t al = uint32_t(a);
+        uint64_t ah = a >> 32;
+        uint64_t bl = uint32_t(b);
+        uint64_t bh = b >> 32;
+        uint64_t ll = al * bl;
+        uint64_t lh = al * bh;
+        uint64_t hl = ah * bl;
+        uint64_t hh = ah * bh;
+        uint64_t middle = (ll >> 32) + uint32_t(lh) + uint32_t(hl);
+        return hh + (lh >> 32) + (hl >> 32) + (middle >> 32);
+    }
+}
+//------------------------------------------------------------------------------
+template<typename I, typename F>
+static I convert(F value)
+{
+    if (isnan(value))
+        return std::numeric_limits<I>::max();
+    if (value <= F(std::numeric_limits<I>::min()))
+        return std::numeric_limits<I>::min();
+    if (value >= F(std::numeric_limits<I>::max()))
+        return std::numeric_limits<I>::max();
+    return I(value);
+}
+//------------------------------------------------------------------------------
+template<typename F>
+static F scalar(const riscv_cpu& cpu)
+{
+    if constexpr (sizeof(F) == sizeof(float))
+    {
+        return cpu.f[cpu.rs1].f;
+    }
+    else
+    {
+        F value;
+        memcpy(&value, &cpu.f[cpu.rs1].u64, sizeof(F));
+        return value;
+    }
+}
+//------------------------------------------------------------------------------
+// Table 10: OPIVV / OPIVX / OPIVI
+//------------------------------------------------------------------------------
+template<typename U>
+static void integer(riscv_cpu& cpu, bool vector, U scalar)
+{
+    typedef std::make_signed_t<U> S;
+    const U shift = sizeof(U) * 8 - 1;
+
+    switch (cpu.funct7 >> 1)
+    {
+    case 0b000000: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return a + b; });
+    case 0b000010: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return a - b; });
+    case 0b000011: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return b - a; });
+    case 0b000100: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return a < b ? a : b; });
+    case 0b000101: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return S(a) < S(b) ? a : b; });
+    case 0b000110: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return a > b ? a : b; });
+    case 0b000111: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return S(a) > S(b) ? a : b; });
+    case 0b001001: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return a & b; });
+    case 0b001010: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return a | b; });
+    case 0b001011: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return a ^ b; });
+    case 0b010111: return merge<U>(cpu, vector, scalar);
+    case 0b011000: return compare<U>(cpu, vector, scalar, [](U a, U b) { return a == b; });
+    case 0b011001: return compare<U>(cpu, vector, scalar, [](U a, U b) { return a != b; });
+    case 0b011010: return compare<U>(cpu, vector, scalar, [](U a, U b) { return a < b; });
+    case 0b011011: return compare<U>(cpu, vector, scalar, [](U a, U b) { return S(a) < S(b); });
+    case 0b011100: return compare<U>(cpu, vector, scalar, [](U a, U b) { return a <= b; });
+    case 0b011101: return compare<U>(cpu, vector, scalar, [](U a, U b) { return S(a) <= S(b); });
+    case 0b011110: return compare<U>(cpu, vector, scalar, [](U a, U b) { return a > b; });
+    case 0b011111: return compare<U>(cpu, vector, scalar, [](U a, U b) { return S(a) > S(b); });
+    case 0b100101: return binary<U>(cpu, vector, scalar, [shift](U a, U b) -> U { return a << (b & shift); });
+    case 0b101000: return binary<U>(cpu, vector, scalar, [shift](U a, U b) -> U { return a >> (b & shift); });
+    case 0b101001: return binary<U>(cpu, vector, scalar, [shift](U a, U b) -> U { return S(a) >> (b & shift); });
+    }
+}
+//------------------------------------------------------------------------------
+// Table 11: OPMVV / OPMVX
+//------------------------------------------------------------------------------
+template<typename U>
+static void multiply(riscv_cpu& cpu, bool vector, U scalar)
+{
+    typedef std::make_signed_t<U> S;
+    const S minimum = std::numeric_limits<S>::min();
+
+    switch (cpu.funct7 >> 1)
+    {
+    case 0b000000: return reduce<U>(cpu, [](U a, U b) -> U { return a + b; });
+    case 0b000001: return reduce<U>(cpu, [](U a, U b) -> U { return a & b; });
+    case 0b000010: return reduce<U>(cpu, [](U a, U b) -> U { return a | b; });
+    case 0b000011: return reduce<U>(cpu, [](U a, U b) -> U { return a ^ b; });
+    case 0b000100: return reduce<U>(cpu, [](U a, U b) -> U { return a < b ? a : b; });
+    case 0b000101: return reduce<U>(cpu, [](U a, U b) -> U { return S(a) < S(b) ? a : b; });
+    case 0b000110: return reduce<U>(cpu, [](U a, U b) -> U { return a > b ? a : b; });
+    case 0b000111: return reduce<U>(cpu, [](U a, U b) -> U { return S(a) > S(b) ? a : b; });
+    case 0b010000:
+        if (vector == false)
+        {
+            // vmv.s.x
+            if (cpu.vl)
+                ((U*)cpu.v[cpu.rd])[0] = scalar;
+            return;
+        }
+        switch (cpu.rs1)
+        {
+        case 0b00000:
+            // vmv.x.s
+            cpu.x[cpu.rd] = intptr_t(S(((U*)cpu.v[cpu.rs2])[0]));
+            return;
+        case 0b10000:
+        case 0b10001:
+        {
+            // vcpop.m / vfirst.m
+            bool vm = cpu.funct7 & 1;
+            intptr_t count = 0;
+            intptr_t first = -1;
+            for (size_t i = 0; i < cpu.vl; ++i)
+            {
+                if ((vm || mask(cpu, i)) && ((cpu.v[cpu.rs2][i >> 3] >> (i & 7)) & 1))
+                {
+                    if (first < 0)
+                        first = i;
+                    count++;
+                }
+            }
+            cpu.x[cpu.rd] = (cpu.rs1 == 0b10000) ? count : first;
+            return;
+        }
+        }
+        return;
+    case 0b010100:
+        if (vector && cpu.rs1 == 0b10001)
+        {
+            // vid.v
+            if (group(cpu, lmul(cpu), cpu.rd) == false)
+                return;
+            U* d = (U*)cpu.v[cpu.rd];
+            bool vm = cpu.funct7 & 1;
+            for (size_t i = 0; i < cpu.vl; ++i)
+            {
+                if (vm || mask(cpu, i))
+                    d[i] = U(i);
+            }
+        }
+        return;
+    case 0b100000: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return b ? a / b : U(-1); });
+    case 0b100001: return binary<U>(cpu, vector, scalar, [minimum](U a, U b) -> U { return b == 0 ? U(-1) : (S(a) == minimum && S(b) == -1) ? a : U(S(a) / S(b)); });
+    case 0b100010: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return b ? a % b : a; });
+    case 0b100011: return binary<U>(cpu, vector, scalar, [minimum](U a, U b) -> U { return b == 0 ? a : (S(a) == minimum && S(b) == -1) ? 0 : U(S(a) % S(b)); });
+    case 0b100100: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return mulhu(a, b); });
+    case 0b100101: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return a * b; });
+    case 0b100110: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return mulhu(a, b) - (S(a) < 0 ? b : 0); });
+    case 0b100111: return binary<U>(cpu, vector, scalar, [](U a, U b) -> U { return mulhu(a, b) - (S(a) < 0 ? b : 0) - (S(b) < 0 ? a : 0); });
+    case 0b101001: return ternary<U>(cpu, vector, scalar, [](U d, U a, U b) -> U { return b * d + a; });
+    case 0b101011: return ternary<U>(cpu, vector, scalar, [](U d, U a, U b) -> U { return a - b * d; });
+    case 0b101101: return ternary<U>(cpu, vector, scalar, [](U d, U a, U b) -> U { return b * a + d; });
+    case 0b101111: return ternary<U>(cpu, vector, scalar, [](U d, U a, U b) -> U { return d - b * a; });
+    }
+}
+//------------------------------------------------------------------------------
+// Table 12: OPFVV / OPFVF
+//------------------------------------------------------------------------------
+template<typename F>
+static void floating(riscv_cpu& cpu, bool vector, F scalar)
+{
+    typedef std::conditional_t<sizeof(F) == sizeof(uint32_t), uint32_t, uint64_t> U;
+    typedef std::make_signed_t<U> S;
+
+    switch (cpu.funct7 >> 1)
+    {
+    case 0b000000: return binary<F>(cpu, vector, scalar, [](F a, F b) { return a + b; });
+    case 0b000001: return reduce<F>(cpu, [](F a, F b) { return a + b; });
+    case 0b000010: return binary<F>(cpu, vector, scalar, [](F a, F b) { return a - b; });
+    case 0b000011: return reduce<F>(cpu, [](F a, F b) { return a + b; });
+    case 0b000100: return binary<F>(cpu, vector, scalar, [](F a, F b) { return fmin(a, b); });
+    case 0b000101: return reduce<F>(cpu, [](F a, F b) { return fmin(a, b); });
+    case 0b000110: return binary<F>(cpu, vector, scalar, [](F a, F b) { return fmax(a, b); });
+    case 0b000111: return reduce<F>(cpu, [](F a, F b) { return fmax(a, b); });
+    case 0b001000: return binary<F>(cpu, vector, scalar, [](F a, F b) { return copysign(a, b); });
+    case 0b001001: return binary<F>(cpu, vector, scalar, [](F a, F b) { return copysign(a, -b); });
+    case 0b001010: return binary<F>(cpu, vector, scalar, [](F a, F b) { return signbit(b) ? -a : a; });
+    case 0b010000:
+        if (vector == false)
+        {
+            // vfmv.s.f
+            if (cpu.vl)
+                ((F*)cpu.v[cpu.rd])[0] = scalar;
+        }
+        else if (cpu.rs1 == 0b00000)
+        {
+            // vfmv.f.s
+            F value = ((F*)cpu.v[cpu.rs2])[0];
+            if constexpr (sizeof(F) == sizeof(float))
+                cpu.f[cpu.rd].f = value;
+            else
+                memcpy(&cpu.f[cpu.rd].u64, &value, sizeof(F));
+        }
+        return;
+    case 0b010010:
+        if (vector == false)
+            return;
+        switch (cpu.rs1)
+        {
+        case 0b00000: return unary<U, F>(cpu, [](F a) { return convert<U>(nearbyint(a)); });
+        case 0b00001: return unary<S, F>(cpu, [](F a) { return convert<S>(nearbyint(a)); });
+        case 0b00010: return unary<F, U>(cpu, [](U a) { return F(a); });
+        case 0b00011: return unary<F, S>(cpu, [](S a) { return F(a); });
+        case 0b00110: return unary<U, F>(cpu, [](F a) { return convert<U>(trunc(a)); });
+        case 0b00111: return unary<S, F>(cpu, [](F a) { return convert<S>(trunc(a)); });
+        }
+        return;
+    case 0b010011:
+        if (vector && cpu.rs1 == 0b00000)
+            return unary<F, F>(cpu, [](F a) { return F(sqrt(a)); });
+        return;
+    case 0b010111: return merge<F>(cpu, vector, scalar);
+    case 0b011000: return compare<F>(cpu, vector, scalar, [](F a, F b) { return a == b; });
+    case 0b011001: return compare<F>(cpu, vector, scalar, [](F a, F b) { return a <= b; });
+    case 0b011011: return compare<F>(cpu, vector, scalar, [](F a, F b) { return a < b; });
+    case 0b011100: return compare<F>(cpu, vector, scalar, [](F a, F b) { return a != b; });
+    case 0b011101: return compare<F>(cpu, vector, scalar, [](F a, F b) { return a > b; });
+    case 0b011111: return compare<F>(cpu, vector, scalar, [](F a, F b) { return a >= b; });
+    case 0b100000: return binary<F>(cpu, vector, scalar, [](F a, F b) { return a / b; });
+    case 0b100001: return binary<F>(cpu, vector, scalar, [](F a, F b) { return b / a; });
+    case 0b100100: return binary<F>(cpu, vector, scalar, [](F a, F b) { return a * b; });
+    case 0b100111: return binary<F>(cpu, vector, scalar, [](F a, F b) { return b - a; });
+    case 0b101000: return ternary<F>(cpu, vector, scalar, [](F d, F a, F b) { return (d * b) + a; });
+    case 0b101001: return ternary<F>(cpu, vector, scalar, [](F d, F a, F b) { return -(d * b) - a; });
+    case 0b101010: return ternary<F>(cpu, vector, scalar, [](F d, F a, F b) { return (d * b) - a; });
+    case 0b101011: return ternary<F>(cpu, vector, scalar, [](F d, F a, F b) { return -(d * b) + a; });
+    case 0b101100: return ternary<F>(cpu, vector, scalar, [](F d, F a, F b) { return (b * a) + d; });
+    case 0b101101: return ternary<F>(cpu, vector, scalar, [](F d, F a, F b) { return -(b * a) - d; });
+    case 0b101110: return ternary<F>(cpu, vector, scalar, [](F d, F a, F b) { return (b * a) - d; });
+    case 0b101111: return ternary<F>(cpu, vector, scalar, [](F d, F a, F b) { return -(b * a) + d; });
+    }
+}
+//------------------------------------------------------------------------------
+// Mask-register logical instructions
+//------------------------------------------------------------------------------
+static void logical(riscv_cpu& cpu)
+{
+    uint8_t* d = cpu.v[cpu.rd];
+    const uint8_t* a = cpu.v[cpu.rs2];
+    const uint8_t* b = cpu.v[cpu.rs1];
+    for (size_t i = 0; i < riscv_cpu::VLENB; ++i)
+    {
+        switch (cpu.funct7 >> 1)
+        {
+        case 0b011000: d[i] = a[i] & ~b[i];     break;
+        case 0b011001: d[i] = a[i] & b[i];      break;
+        case 0b011010: d[i] = a[i] | b[i];      break;
+        case 0b011011: d[i] = a[i] ^ b[i];      break;
+        case 0b011100: d[i] = a[i] | ~b[i];     break;
+        case 0b011101: d[i] = ~(a[i] & b[i]);   break;
+        case 0b011110: d[i] = ~(a[i] | b[i]);   break;
+        case 0b011111: d[i] = ~(a[i] ^ b[i]);   break;
+        }
+    }
+}
+//------------------------------------------------------------------------------
+template<typename T>
+static void gather(riscv_cpu& cpu, const uint8_t* base, intptr_t stride)
+{
+    T* d = (T*)cpu.v[cpu.rd];
+    size_t vl = cpu.vl;
+    bool vm = cpu.funct7 & 1;
+    for (size_t i = 0; i < vl; ++i)
+    {
+        if (vm || mask(cpu, i))
+            d[i] = *(T*)(base + i * stride);
+    }
+}
+//------------------------------------------------------------------------------
+template<typename T>
+static void scatter(riscv_cpu& cpu, uint8_t* base, intptr_t stride)
+{
+    const T* a = (T*)cpu.v[cpu.rd];
+    size_t vl = cpu.vl;
+    bool vm = cpu.funct7 & 1;
+    for (size_t i = 0; i < vl; ++i)
+    {
+        if (vm || mask(cpu, i))
+            *(T*)(base + i * stride) = a[i];
+    }
+}
+//------------------------------------------------------------------------------
+static size_t width(uint32_t funct3)
+{
+    switch (funct3)
+    {
+    case 0b000: return sizeof(uint8_t);
+    case 0b101: return sizeof(uint16_t);
+    case 0b110: return sizeof(uint32_t);
+    case 0b111: return sizeof(uint64_t);
+    }
+    return 0;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::VLOAD()
+{
+    const uint8_t* base = (uint8_t*)x[rs1].u;
+    size_t eew = width(funct3);
+    size_t nf = funct7 >> 4;
+    intptr_t stride = eew;
+    switch ((funct7 >> 1) & 0b11)
+    {
+    case 0b00:
+        switch (rs2)
+        {
+        case 0b01000:
+            // vl<nf>r.v
+            if (group(*this, nf + 1, rd) == false)
+                return;
+            memcpy(v[rd], base, (nf + 1) * VLENB);
+            return;
+        case 0b01011:
+            // vlm.v
+            memcpy(v[rd], base, (vl + 7) / 8);
+            return;
+        case 0b00000:
+        case 0b10000:
+            if (nf)
+                return HINT();
+            if (group(*this, emul(*this, eew), rd) == false)
+                return;
+            if (funct7 & 1)
+            {
+                memcpy(v[rd], base, vl * eew);
+                return;
+            }
+            break;
+        default:
+            return HINT();
+        }
+        break;
+    case 0b10:
+        if (nf)
+            return HINT();
+        if (group(*this, emul(*this, eew), rd) == false)
+            return;
+        stride = x[rs2].s;
+        break;
+    default:
+        return HINT();
+    }
+    switch (eew)
+    {
+    case sizeof(uint8_t):   return gather<uint8_t>(*this, base, stride);
+    case sizeof(uint16_t):  return gather<uint16_t>(*this, base, stride);
+    case sizeof(uint32_t):  return gather<uint32_t>(*this, base, stride);
+    case sizeof(uint64_t):  return gather<uint64_t>(*this, base, stride);
+    }
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::VSTORE()
+{
+    uint8_t* base = (uint8_t*)x[rs1].u;
+    size_t eew = width(funct3);
+    size_t nf = funct7 >> 4;
+    intptr_t stride = eew;
+    switch ((funct7 >> 1) & 0b11)
+    {
+    case 0b00:
+        switch (rs2)
+        {
+        case 0b01000:
+            // vs<nf>r.v
+            if (group(*this, nf + 1, rd) == false)
+                return;
+            memcpy(base, v[rd], (nf + 1) * VLENB);
+            return;
+        case 0b01011:
+            // vsm.v
+            memcpy(base, v[rd], (vl + 7) / 8);
+            return;
+        case 0b00000:
+            if (nf)
+                return HINT();
+            if (group(*this, emul(*this, eew), rd) == false)
+                return;
+            if (funct7 & 1)
+            {
+                memcpy(base, v[rd], vl * eew);
+                return;
+            }
+            break;
+        default:
+            return HINT();
+        }
+        break;
+    case 0b10:
+        if (nf)
+            return HINT();
+        if (group(*this, emul(*this, eew), rd) == false)
+            return;
+        stride = x[rs2].s;
+        break;
+    default:
+        return HINT();
+    }
+    switch (eew)
+    {
+    case sizeof(uint8_t):   return scatter<uint8_t>(*this, base, stride);
+    case sizeof(uint16_t):  return scatter<uint16_t>(*this, base, stride);
+    case sizeof(uint32_t):  return scatter<uint32_t>(*this, base, stride);
+    case sizeof(uint64_t):  return scatter<uint64_t>(*this, base, stride);
+    }
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPIVV()
+{
+    integers(vtype, [this](auto type) { integer<decltype(type)>(*this, true, 0); });
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPIVX()
+{
+    integers(vtype, [this](auto type) { integer<decltype(type)>(*this, false, decltype(type)(x[rs1].u)); });
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPIVI()
+{
+    switch (funct7 >> 1)
+    {
+    case 0b100111:
+        // vmv<nr>r.v
+        if (group(*this, (rs1 & 0b111) + 1, rd, rs2) == false)
+            return;
+        memcpy(v[rd], v[rs2], ((rs1 & 0b111) + 1) * VLENB);
+        return;
+    case 0b100101:
+    case 0b101000:
+    case 0b101001:
+        // Shift amounts are unsigned
+        integers(vtype, [this](auto type) { integer<decltype(type)>(*this, false, decltype(type)(rs1)); });
+        return;
+    }
+    intptr_t simm5 = int32_t(rs1 << 27) >> 27;
+    integers(vtype, [this, simm5](auto type) { integer<decltype(type)>(*this, false, decltype(type)(simm5)); });
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPMVV()
+{
+    switch (funct7 >> 1)
+    {
+    case 0b011000:
+    case 0b011001:
+    case 0b011010:
+    case 0b011011:
+    case 0b011100:
+    case 0b011101:
+    case 0b011110:
+    case 0b011111:
+        return logical(*this);
+    }
+    integers(vtype, [this](auto type) { multiply<decltype(type)>(*this, true, 0); });
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPMVX()
+{
+    integers(vtype, [this](auto type) { multiply<decltype(type)>(*this, false, decltype(type)(x[rs1].u)); });
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPFVV()
+{
+    floats(vtype, [this](auto type) { floating<decltype(type)>(*this, true, 0); });
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPFVF()
+{
+    floats(vtype, [this](auto type) { floating<decltype(type)>(*this, false, scalar<decltype(type)>(*this)); });
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::OPCFG()
+{
+    uintptr_t type;
+    uintptr_t avl = rs1 ? x[rs1].u : rd ? UINTPTR_MAX : vl;
+    if ((format >> 31) == 0)
+    {
+        // vsetvli
+        type = (format >> 20) & 0x7FF;
+    }
+    else if ((format >> 30) == 0b11)
+    {
+        // vsetivli
+        type = (format >> 20) & 0x3FF;
+        avl = rs1;
+    }
+    else
+    {
+        // vsetvl
+        type = x[rs2].u;
+    }
+
+    // VLMAX = LMUL * VLEN / SEW
+    uintptr_t vsew = (type >> 3) & 0b111;
+    uintptr_t vlmul = type & 0b111;
+    uintptr_t vlmax = VLENB >> vsew;
+    bool valid = (vsew <= 0b011 && vlmul != 0b100 && (type >> 8) == 0);
+    if (vlmul < 0b100)
+    {
+        vlmax <<= vlmul;
+    }
+    else
+    {
+        vlmax >>= (8 - vlmul);
+        valid = valid && (8u << vsew) <= (64u >> (8 - vlmul));
+    }
+
+    if (valid && vlmax)
+    {
+        vtype = type;
+        vl = avl < vlmax ? avl : vlmax;
+    }
+    else
+    {
+        vtype = uintptr_t(1) << (sizeof(uintptr_t) * 8 - 1);
+        vl = 0;
+    }
+    x[rd] = vl;
+}
+//------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,91 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#include "riscv_scheduler.h"
+
+//------------------------------------------------------------------------------
+riscv_scheduler::riscv_scheduler(size_t threads, size_t quantum)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    retire = [](riscv_cpu& cpu, int reason) {};
+
+    this->quantum = quantum ? quantum : 1;
+    active = 0;
+    terminate = false;
+    for (size_t i = 0; i < threads; ++i)
+    {
+        this->threads.emplace_back(&riscv_scheduler::worker, this);
+    }
+}
+//------------------------------------------------------------------------------
+riscv_scheduler::~riscv_scheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        terminate = true;
+    }
+    readyCondition.notify_all();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+//------------------------------------------------------------------------------
+void riscv_scheduler::add(riscv_cpu* cpu)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(cpu);
+    }
+    readyCondition.notify_one();
+}
+//------------------------------------------------------------------------------
+void riscv_scheduler::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idleCondition.wait(lock, [this] { return ready.empty() && active == 0; });
+}
+//------------------------------------------------------------------------------
+void riscv_scheduler::worker()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        readyCondition.wait(lock, [this] { return terminate || ready.empty() == false; });
+        if (terminate)
+            break;
+
+        riscv_cpu* cpu = ready.front();
+        ready.pop_front();
+        active++;
+        lock.unlock();
+
+        // One time slice, system calls and breakpoints end it early
+        int reason = cpu->run(quantum);
+        bool finished = (reason == riscv_cpu::RUN_EXIT || reason == riscv_cpu::RUN_FAULT);
+        if (finished)
+            retire(*cpu, reason);
+
+        // Round robin, the cpu goes to the back of the queue
+        lock.lock();
+        active--;
+        if (finished == false)
+        {
+            ready.push_back(cpu);
+            readyCondition.notify_one();
+        }
+        else if (ready.empty() && active == 0)
+        {
+            idleCondition.notify_all();
+        }
+    }
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,40 @@
+//==============================================================================
+// The RISC-V Instruction Set Manual
+// Volume I: Unprivileged ISA
+// Document Version 20191213
+// December 13, 2019
+//==============================================================================
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "riscv_cpu.h"
+
+struct riscv_scheduler
+{
+    riscv_scheduler(size_t threads = 0, size_t quantum = 65536);
+    ~riscv_scheduler();
+
+    void add(riscv_cpu* cpu);
+    void wait();
+
+public:
+    // Called from a worker thread when a cpu exits or faults
+    void (*retire)(riscv_cpu& cpu, int reason);
+
+protected:
+    void worker();
+
+    std::vector<std::thread> threads;
+    std::deque<riscv_cpu*> ready;
+    std::mutex mutex;
+    std::condition_variable readyCondition;
+    std::condition_variable idleCondition;
+    size_t quantum;
+    size_t active;
+    bool terminate;
+};
@@ -0,0 +1,49 @@
+//==============================================================================
+// RISC-V Bit-Manipulation ISA-extensions
+// Version 1.0.0
+// June 6, 2021
+//==============================================================================
+
+#include "riscv_cpu.h"
+
+//------------------------------------------------------------------------------
+void riscv_cpu::SH1ADD()
+{
+    x[rd] = (x[rs1].u << 1) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SH2ADD()
+{
+    x[rd] = (x[rs1].u << 2) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SH3ADD()
+{
+    x[rd] = (x[rs1].u << 3) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ADD_UW()
+{
+    x[rd] = uintptr_t(x[rs1].u32) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SH1ADD_UW()
+{
+    x[rd] = (uintptr_t(x[rs1].u32) << 1) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SH2ADD_UW()
+{
+    x[rd] = (uintptr_t(x[rs1].u32) << 2) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SH3ADD_UW()
+{
+    x[rd] = (uintptr_t(x[rs1].u32) << 3) + x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SLLI_UW()
+{
+    x[rd] = uintptr_t(x[rs1].u32) << (immI() & 0b111111);
+}
+//------------------------------------------------------------------------------
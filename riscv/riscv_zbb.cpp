@@ -0,0 +1,146 @@
+//==============================================================================
+// RISC-V Bit-Manipulation ISA-extensions
+// Version 1.0.0
+// June 6, 2021
+//==============================================================================
+
+#include "riscv_cpu.h"
+
+#define XLEN (sizeof(uintptr_t) * 8)
+
+//------------------------------------------------------------------------------
+void riscv_cpu::ANDN()
+{
+    x[rd] = x[rs1].u & ~x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ORN()
+{
+    x[rd] = x[rs1].u | ~x[rs2].u;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::XNOR()
+{
+    x[rd] = ~(x[rs1].u ^ x[rs2].u);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CLZ()
+{
+    x[rd] = x[rs1].u ? __builtin_clzll(x[rs1].u) - (64 - XLEN) : XLEN;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CLZW()
+{
+    x[rd] = x[rs1].u32 ? __builtin_clz(x[rs1].u32) : 32;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CTZ()
+{
+    x[rd] = x[rs1].u ? __builtin_ctzll(x[rs1].u) : XLEN;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CTZW()
+{
+    x[rd] = x[rs1].u32 ? __builtin_ctz(x[rs1].u32) : 32;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CPOP()
+{
+    x[rd] = __builtin_popcountll(x[rs1].u);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::CPOPW()
+{
+    x[rd] = __builtin_popcount(x[rs1].u32);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::MAX()
+{
+    x[rd] = x[rs1].s < x[rs2].s ? x[rs2] : x[rs1];
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::MAXU()
+{
+    x[rd] = x[rs1].u < x[rs2].u ? x[rs2] : x[rs1];
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::MIN()
+{
+    x[rd] = x[rs1].s < x[rs2].s ? x[rs1] : x[rs2];
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::MINU()
+{
+    x[rd] = x[rs1].u < x[rs2].u ? x[rs1] : x[rs2];
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SEXT_B()
+{
+    x[rd] = x[rs1].s8;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::SEXT_H()
+{
+    x[rd] = x[rs1].s16;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ZEXT_H()
+{
+    x[rd] = x[rs1].u16;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ROL()
+{
+    uintptr_t shamt = x[rs2].u & (XLEN - 1);
+    x[rd] = (x[rs1].u << shamt) | (x[rs1].u >> (-shamt & (XLEN - 1)));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ROLW()
+{
+    uint32_t shamt = x[rs2].u32 & 31;
+    x[rd] = (int32_t)((x[rs1].u32 << shamt) | (x[rs1].u32 >> (-shamt & 31)));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ROR()
+{
+    uintptr_t shamt = x[rs2].u & (XLEN - 1);
+    x[rd] = (x[rs1].u >> shamt) | (x[rs1].u << (-shamt & (XLEN - 1)));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::RORI()
+{
+    uintptr_t shamt = immI() & (XLEN - 1);
+    x[rd] = (x[rs1].u >> shamt) | (x[rs1].u << (-shamt & (XLEN - 1)));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::RORIW()
+{
+    uint32_t shamt = immI() & 31;
+    x[rd] = (int32_t)((x[rs1].u32 >> shamt) | (x[rs1].u32 << (-shamt & 31)));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::RORW()
+{
+    uint32_t shamt = x[rs2].u32 & 31;
+    x[rd] = (int32_t)((x[rs1].u32 >> shamt) | (x[rs1].u32 << (-shamt & 31)));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::ORC_B()
+{
+    // The low bit of every byte collects the byte, then spreads back to 0xFF
+    uint64_t value = x[rs1].u;
+    value |= (value >> 4) & 0x0F0F0F0F0F0F0F0Full;
+    value |= (value >> 2) & 0x3333333333333333ull;
+    value |= (value >> 1) & 0x5555555555555555ull;
+    x[rd] = uintptr_t((value & 0x0101010101010101ull) * 0xFF);
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::REV8()
+{
+#if defined(__LP64__)
+    x[rd] = __builtin_bswap64(x[rs1].u);
+#else
+    x[rd] = __builtin_bswap32(x[rs1].u);
+#endif
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,51 @@
+//==============================================================================
+// RISC-V Bit-Manipulation ISA-extensions
+// Version 1.0.0
+// June 6, 2021
+//==============================================================================
+
+#include "riscv_cpu.h"
+
+#define XLEN (sizeof(uintptr_t) * 8)
+
+//------------------------------------------------------------------------------
+void riscv_cpu::BCLR()
+{
+    x[rd] = x[rs1].u & ~(uintptr_t(1) << (x[rs2].u & (XLEN - 1)));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BCLRI()
+{
+    x[rd] = x[rs1].u & ~(uintptr_t(1) << (immI() & (XLEN - 1)));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BEXT()
+{
+    x[rd] = (x[rs1].u >> (x[rs2].u & (XLEN - 1))) & 1;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BEXTI()
+{
+    x[rd] = (x[rs1].u >> (immI() & (XLEN - 1))) & 1;
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BINV()
+{
+    x[rd] = x[rs1].u ^ (uintptr_t(1) << (x[rs2].u & (XLEN - 1)));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BINVI()
+{
+    x[rd] = x[rs1].u ^ (uintptr_t(1) << (immI() & (XLEN - 1)));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BSET()
+{
+    x[rd] = x[rs1].u | (uintptr_t(1) << (x[rs2].u & (XLEN - 1)));
+}
+//------------------------------------------------------------------------------
+void riscv_cpu::BSETI()
+{
+    x[rd] = x[rs1].u | (uintptr_t(1) << (immI() & (XLEN - 1)));
+}
+//------------------------------------------------------------------------------
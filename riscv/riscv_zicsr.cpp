@@ -5,13 +5,48 @@
 // December 13, 2019
 //==============================================================================
 
+#include <chrono>
 #include "riscv_cpu.h"
 
+//------------------------------------------------------------------------------
+static uint64_t timer()
+{
+    // 1 GHz timebase
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
 //------------------------------------------------------------------------------
 void riscv_cpu::CSRRW()
 {
     switch (immI())
     {
+    case 0xB00:
+    {
+        uint64_t value = x[rs1].u;
+        x[rd] = instret + cycleBias;
+        cycleBias = value - instret;
+        break;
+    }
+    case 0xB02:
+    {
+        uint64_t value = x[rs1].u;
+        x[rd] = instret;
+        cycleBias += instret - value;
+        instret = value;
+        break;
+    }
+    case 0xB03:
+    case 0xB04:
+    case 0xB05:
+    case 0xB06:
+    case 0xB07:
+    {
+        uint64_t value = x[rs1].u;
+        x[rd] = hpmcounter[immI() & 0x1F];
+        hpmcounter[immI() & 0x1F] = value;
+        break;
+    }
     case 0x001:
         x[rd] = fcsr.fflags;
         if (rs1 == 0)
@@ -38,6 +73,43 @@ void riscv_cpu::CSRRS()
 {
     switch (immI())
     {
+    case 0xB00:
+    case 0xC00:
+        x[rd] = instret + cycleBias;
+        break;
+    case 0xC01:
+        x[rd] = timer();
+        break;
+    case 0xB02:
+    case 0xC02:
+        x[rd] = instret;
+        break;
+    case 0xB03:
+    case 0xB04:
+    case 0xB05:
+    case 0xB06:
+    case 0xB07:
+    case 0xC03:
+    case 0xC04:
+    case 0xC05:
+    case 0xC06:
+    case 0xC07:
+        x[rd] = hpmcounter[immI() & 0x1F];
+        break;
+#if RISCV_HAVE_VECTOR
+    case 0x008:
+        x[rd] = vstart;
+        break;
+    case 0xC20:
+        x[rd] = vl;
+        break;
+    case 0xC21:
+        x[rd] = vtype;
+        break;
+    case 0xC22:
+        x[rd] = VLENB;
+        break;
+#endif
     case 0x001:
         x[rd] = fcsr.fflags;
         if (rs1 == 0)
@@ -10,6 +10,9 @@
 //------------------------------------------------------------------------------
 void riscv_cpu::FENCE_I()
 {
-    
+#if RISCV_HAVE_JIT
+    // Translated blocks may hold stale instructions
+    translator.flush();
+#endif
 }
 //------------------------------------------------------------------------------
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static constexpr uint32_t syscall_hash(const char* name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash ^= uint8_t(*name++);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+template<size_t COUNT>
+struct syscall_hash_index {
+    static constexpr size_t SIZE = []() {
+        size_t size = 1;
+        while (size < COUNT * 2)
+            size <<= 1;
+        return size;
+    }();
+
+    uint32_t hashes[SIZE] = {};
+    uint16_t slots[SIZE] = {};      // table index + 1, 0 is empty
+
+    template<typename T>
+    constexpr syscall_hash_index(const T (&table)[COUNT]) {
+        static_assert(COUNT < UINT16_MAX);
+        for (size_t index = 0; index < COUNT; ++index) {
+            uint32_t hash = syscall_hash(table[index].name);
+            size_t slot = hash & (SIZE - 1);
+            while (slots[slot])
+                slot = (slot + 1) & (SIZE - 1);
+            hashes[slot] = hash;
+            slots[slot] = uint16_t(index + 1);
+        }
+    }
+
+    template<typename T>
+    size_t find(const T (&table)[COUNT], const char* name) const {
+        uint32_t hash = syscall_hash(name);
+        for (size_t slot = hash & (SIZE - 1); slots[slot]; slot = (slot + 1) & (SIZE - 1)) {
+            if (hashes[slot] != hash)
+                continue;
+            size_t index = slots[slot] - 1;
+            if (strcmp(table[index].name, name) == 0)
+                return index;
+        }
+        return SIZE_MAX;
+    }
+};
@@ -1,7 +1,11 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
 #include "syscall.h"
+#include "syscall_hash.h"
 #include "syscall_internal.h"
 #include "x86/x86_i386.h"
 
@@ -54,6 +58,8 @@ extern "C" {
 
 #include "syscall_table.h"
 
+static constexpr syscall_hash_index syscall_index(syscall_table);
+
 size_t syscall_i386_new(void* data, const char* path, int argc, const char* argv[], int envc, const char* envp[])
 {
     auto* cpu = (x86_i386*)data;
@@ -99,17 +105,109 @@ size_t syscall_i386_execute(void* data, size_t index, int(*syslog)(const char*,
     return 0;
 }
 
+int syscall_i386_effect(void* data, size_t index, size_t* writes)
+{
+    index = uint32_t(-index - SYMBOL_INDEX);
+
+    // Opening a file runs live, replay needs the same files
+    // Every read of a stream position is journaled, the host stream does not move on replay
+    size_t count = sizeof(syscall_table) / sizeof(syscall_table[0]);
+    if (index < count) {
+        auto* cpu = (x86_i386*)data;
+        auto& x86 = cpu->x86;
+        auto* memory = cpu->Memory();
+        auto* stack = (uint32_t*)(memory + cpu->Stack());
+        auto result = x86.regs[0].d;
+        auto guest = [&](uint32_t address) { return address != 0 && address < x86.memory_size; };
+        switch (syscall_hash(syscall_table[index].name)) {
+        case syscall_hash("clock"):
+        case syscall_hash("feof"):
+        case syscall_hash("ferror"):
+        case syscall_hash("fgetc"):
+        case syscall_hash("fgetwc"):
+        case syscall_hash("fseek"):
+        case syscall_hash("fsetpos"):
+        case syscall_hash("ftell"):
+        case syscall_hash("getc"):
+        case syscall_hash("getchar"):
+        case syscall_hash("getwc"):
+        case syscall_hash("getwchar"):
+        case syscall_hash("rand"):
+        case syscall_hash("remove"):
+        case syscall_hash("rename"):
+        case syscall_hash("rewind"):
+        case syscall_hash("system"):
+            return 0;
+        case syscall_hash("fgets"):
+        case syscall_hash("getcwd"):
+        case syscall_hash("gets"):
+            if (result == 0)
+                return 0;
+            writes[0] = result;
+            writes[1] = strlen(physical(char*, result)) + 1;
+            return 1;
+        case syscall_hash("fgetpos"):
+            writes[0] = stack[2];
+            writes[1] = sizeof(int);
+            return 1;
+        case syscall_hash("fgetws"):
+            if (result == 0)
+                return 0;
+            writes[0] = result;
+            writes[1] = (wcslen(physical(wchar_t*, result)) + 1) * sizeof(wchar_t);
+            return 1;
+        case syscall_hash("fread"):
+            writes[0] = stack[1];
+            writes[1] = size_t(stack[2]) * result;
+            return 1;
+        case syscall_hash("mktime"):
+            writes[0] = stack[1];
+            writes[1] = sizeof(struct tm);
+            return 1;
+        case syscall_hash("time"):
+            if (stack[1] == 0)
+                return 0;
+            writes[0] = stack[1];
+            writes[1] = sizeof(time_t);
+            return 1;
+        case syscall_hash("ctime"):
+        case syscall_hash("getenv"):
+        case syscall_hash("tmpnam"):
+            if (guest(result) == false)
+                return miCPU::EFFECT_EXECUTE;
+            writes[0] = result;
+            writes[1] = strlen(physical(char*, result)) + 1;
+            return miCPU::EFFECT_EXECUTE + 1;
+        case syscall_hash("localtime"):
+            if (guest(result) == false)
+                return miCPU::EFFECT_EXECUTE;
+            writes[0] = result;
+            writes[1] = sizeof(struct tm);
+            return miCPU::EFFECT_EXECUTE + 1;
+        case syscall_hash("fscanf"):
+        case syscall_hash("fwscanf"):
+        case syscall_hash("scanf"):
+        case syscall_hash("vfscanf"):
+        case syscall_hash("vfwscanf"):
+        case syscall_hash("vscanf"):
+        case syscall_hash("vwscanf"):
+        case syscall_hash("wscanf"):
+            return miCPU::EFFECT_UNKNOWN;
+        }
+    }
+
+    return miCPU::EFFECT_NONE;
+}
+
 size_t syscall_i386_symbol(const char* file, const char* name)
 {
     if (file == nullptr)
         return 0;
 
-    size_t count = sizeof(syscall_table) / sizeof(syscall_table[0]);
-    for (size_t index = 0; index < count; ++index) {
-        int shift = (name[0] == '_') ? 1 : 0;
-        if (strcmp(syscall_table[index].name, name + shift) == 0)
-            return (uint32_t)(-index - SYMBOL_INDEX);
-    }
+    int shift = (name[0] == '_') ? 1 : 0;
+    size_t index = syscall_index.find(syscall_table, name + shift);
+    if (index != SIZE_MAX)
+        return (uint32_t)(-index - SYMBOL_INDEX);
 
     return 0;
 }
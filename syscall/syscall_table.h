@@ -1,6 +1,6 @@
 #pragma once
 
-static const struct {
+static constexpr struct {
     const char* name;
     void (*syscall)(CALLBACK_ARGUMENT);
 } syscall_table[] = {
@@ -1,6 +1,8 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include <stdint.h>
 #include <sys/stat.h>
+#include <algorithm>
+#include <mutex>
 #include "windows.h"
 #include "syscall/allocator.h"
 #include "syscall/syscall.h"
@@ -525,6 +527,101 @@ size_t syscall_GetProcAddress(uint8_t* memory, const uint32_t* stack, int(*log)(
     return data.address;
 }
 
+// Loaded, relocated and import-resolved images shared by every guest in the process
+struct ImageCache {
+    std::string path;
+    int64_t mtime;
+    size_t hint;
+    size_t base;
+    std::vector<uint8_t> data;
+};
+static std::mutex imageCacheMutex;
+static std::vector<ImageCache> imageCache;  // Least recently used first
+static const size_t imageCacheLimit = 64 * 1024 * 1024;
+
+static void* LoadLibraryCache(const char* path, x86_i386* cpu, int(*log)(const char*, ...))
+{
+    struct stat st = {};
+    if (stat(path, &st) != 0)
+        return nullptr;
+    int64_t mtime = st.st_mtime;
+
+    auto* memory = cpu->Memory(0, 0);
+    std::lock_guard<std::mutex> lock(imageCacheMutex);
+
+    // Drop the image of the outdated file
+    std::erase_if(imageCache, [&](const ImageCache& cache) {
+        return cache.path == path && cache.mtime != mtime;
+    });
+
+    // Same file, rebased when it lands at another base
+    struct Mapping {
+        x86_i386* cpu;
+        size_t hint;
+        size_t size;
+        uint8_t* image;
+    } mapping = { cpu, 0, 0, nullptr };
+    auto it = std::find_if(imageCache.begin(), imageCache.end(), [&](const ImageCache& cache) {
+        return cache.path == path;
+    });
+    if (it != imageCache.end()) {
+        std::rotate(it, it + 1, imageCache.end());
+        auto& cache = imageCache.back();
+        mapping.hint = cache.hint;
+        mapping.size = cache.data.size();
+        mapping.image = cpu->Memory(mapping.hint, mapping.size);
+        if (mapping.image == nullptr)
+            return nullptr;
+        memcpy(mapping.image, cache.data.data(), cache.data.size());
+        size_t base = mapping.image - memory;
+        if (base == cache.base || PE::Rebase(mapping.image, base, log)) {
+            log("%-12s : %s (cached)", "file", path);
+            return mapping.image;
+        }
+    }
+
+    // Load the file into the reserved range when it has the same size
+    void* image = PE::Load(path, [](size_t base, size_t size, void* userdata) {
+        auto& mapping = *(Mapping*)userdata;
+        if (size == 0)
+            return mapping.cpu->Memory(base, size);
+        if (mapping.image == nullptr || mapping.size != size) {
+            mapping.hint = base;
+            mapping.size = size;
+            mapping.image = mapping.cpu->Memory(base, size);
+        }
+        return mapping.image;
+    }, &mapping, log);
+    PE::Imports(image, [](const char* file, const char* name) {
+        extern size_t syscall_windows_symbol(const char* file, const char* name);
+        extern size_t syscall_i386_symbol(const char* file, const char* name);
+        size_t address = 0;
+        if (address == 0)
+            address = syscall_windows_symbol(file, name);
+        if (address == 0)
+            address = syscall_i386_symbol(file, name);
+        return address;
+    }, log);
+    if (image && mapping.size) {
+        auto* image8 = (uint8_t*)image;
+        std::erase_if(imageCache, [&](const ImageCache& cache) {
+            return cache.path == path;
+        });
+        imageCache.push_back({ path, mtime, mapping.hint, size_t(image8 - memory), std::vector<uint8_t>(image8, image8 + mapping.size) });
+
+        // Drop the least recently used images over the limit
+        size_t total = 0;
+        for (auto& cache : imageCache)
+            total += cache.data.size();
+        while (total > imageCacheLimit && imageCache.size() > 1) {
+            total -= imageCache.front().data.size();
+            imageCache.erase(imageCache.begin());
+        }
+    }
+
+    return image;
+}
+
 size_t syscall_LoadLibraryA(uint8_t* memory, const uint32_t* stack, x86_i386* cpu, int(*log)(const char*, va_list))
 {
     auto* windows = physical(Windows*, TIB_WINDOWS);
@@ -558,20 +655,7 @@ size_t syscall_LoadLibraryA(uint8_t* memory, const uint32_t* stack, x86_i386* cp
     };
     Local::log("[CALL] %s - %s", "LoadLibraryA", lpLibFileName);
 
-    void* image = PE::Load(path.c_str(), [](size_t base, size_t size, void* userdata) {
-        miCPU* cpu = (miCPU*)userdata;
-        return cpu->Memory(base, size);
-    }, cpu, Local::log);
-    PE::Imports(image, [](const char* file, const char* name) {
-        extern size_t syscall_windows_symbol(const char* file, const char* name);
-        extern size_t syscall_i386_symbol(const char* file, const char* name);
-        size_t address = 0;
-        if (address == 0)
-            address = syscall_windows_symbol(file, name);
-        if (address == 0)
-            address = syscall_i386_symbol(file, name);
-        return address;
-    }, Local::log);
+    void* image = LoadLibraryCache(path.c_str(), cpu, Local::log);
     windows->modules.emplace_back(path.substr(slash + 1).c_str(), image);
     if (windows->loadLibraryCallback) {
         windows->loadLibraryCallback(image);
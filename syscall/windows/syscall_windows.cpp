@@ -1,8 +1,10 @@
 #define _CRT_SECURE_NO_WARNINGS
+#include <algorithm>
 #include <string>
 #include <vector>
 #include "syscall/allocator.h"
 #include "syscall/syscall.h"
+#include "syscall/syscall_hash.h"
 #include "syscall/syscall_internal.h"
 #include "syscall_windows.h"
 #include "x86/x86_i386.h"
@@ -34,7 +36,7 @@ extern "C" {
         return count; \
     }
 
-static const struct {
+static constexpr struct {
     const char* name;
     size_t (*syscall)(CALLBACK_ARGUMENT);
 } syscall_table[] = {
@@ -213,6 +215,8 @@ static const struct {
     { "??$?9DU?$char_traits@D@std@@V?$allocator@D@1@@std@@YA_NABV?$basic_string@DU?$char_traits@D@std@@V?$allocator@D@2@@0@PBD@Z",  INT32(0, syscall_basic_string_char_neq_cstr(memory, stack)) },
 };
 
+static constexpr syscall_hash_index syscall_index(syscall_table);
+
 size_t syscall_windows_new(void* data, size_t stack_base, size_t stack_limit, void* image, int argc, const char* argv[], int envc, const char* envp[])
 {
     if (data == nullptr)
@@ -318,16 +322,79 @@ size_t syscall_windows_execute(void* data, size_t index, int(*syslog)(const char
     return 0;
 }
 
+int syscall_windows_effect(void* data, size_t index, size_t* writes)
+{
+    index = uint32_t(-index - SYMBOL_INDEX);
+
+    // Opening a file runs live, replay needs the same files
+    size_t count = sizeof(syscall_table) / sizeof(syscall_table[0]);
+    if (index < count) {
+        auto* cpu = (x86_i386*)data;
+        auto* memory = cpu->Memory();
+        auto* stack = (uint32_t*)(memory + cpu->Stack());
+        auto result = cpu->x86.regs[0].d;
+        switch (syscall_hash(syscall_table[index].name)) {
+        case syscall_hash("GetCurrentProcess"):
+        case syscall_hash("GetCurrentProcessId"):
+        case syscall_hash("GetCurrentThreadId"):
+        case syscall_hash("GetTickCount"):
+            return 0;
+        case syscall_hash("GetSystemTimeAsFileTime"):
+        case syscall_hash("QueryPerformanceCounter"):
+        case syscall_hash("QueryPerformanceFrequency"):
+            writes[0] = stack[1];
+            writes[1] = sizeof(uint64_t);
+            return 1;
+        case syscall_hash("GetCurrentDirectoryA"):
+            writes[0] = stack[2];
+            writes[1] = stack[1];
+            return 1;
+        case syscall_hash("GetFileSize"):
+            if (stack[2] == 0)
+                return 0;
+            writes[0] = stack[2];
+            writes[1] = sizeof(uint32_t);
+            return 1;
+        case syscall_hash("GetFullPathNameA"):
+            if (stack[3] == 0)
+                return 0;
+            writes[0] = stack[3];
+            writes[1] = std::min(result + 1, stack[2]);
+            writes[2] = stack[4];
+            writes[3] = stack[4] ? sizeof(uint32_t) : 0;
+            return 2;
+        case syscall_hash("GetModuleFileNameA"):
+            writes[0] = stack[2];
+            writes[1] = stack[3];
+            return 1;
+        case syscall_hash("FindNextFileA"):
+            writes[0] = stack[2];
+            writes[1] = 320;    // sizeof(WIN32_FIND_DATAA) of the guest
+            return 1;
+        case syscall_hash("FindFirstFileA"):
+            writes[0] = stack[2];
+            writes[1] = 320;    // sizeof(WIN32_FIND_DATAA) of the guest
+            return miCPU::EFFECT_EXECUTE + 1;
+        case syscall_hash("MapViewOfFile"):
+            if (result == 0)
+                return miCPU::EFFECT_EXECUTE;
+            writes[0] = result;
+            writes[1] = cpu->Allocator->size(physical(void*, result));
+            return miCPU::EFFECT_EXECUTE + 1;
+        }
+    }
+
+    return miCPU::EFFECT_NONE;
+}
+
 size_t syscall_windows_symbol(const char* file, const char* name)
 {
     if (file == nullptr)
         return 0;
 
-    size_t count = sizeof(syscall_table) / sizeof(syscall_table[0]);
-    for (size_t index = 0; index < count; ++index) {
-        if (strcmp(syscall_table[index].name, name) == 0)
-            return (uint32_t)(-index - SYMBOL_INDEX);
-    }
+    size_t index = syscall_index.find(syscall_table, name);
+    if (index != SIZE_MAX)
+        return (uint32_t)(-index - SYMBOL_INDEX);
 
     if (strcmp(name, "_iob") == 0)
         return TIB_MSVCRT + offsetof(MSVCRT, iob);
@@ -8,6 +8,7 @@ size_t syscall_windows_new(void* data, size_t stack_base, size_t stack_limit, vo
 size_t syscall_windows_debug(void* data, void(*loadLibraryCallback)(void*));
 size_t syscall_windows_delete(void* data);
 size_t syscall_windows_execute(void* data, size_t index, int(*syslog)(const char*, va_list), int(*log)(const char*, va_list));
+int syscall_windows_effect(void* data, size_t index, size_t* writes);
 size_t syscall_windows_symbol(const char* file, const char* name);
 const char* syscall_windows_name(size_t index);
 
@@ -1,3 +1,4 @@
+#include <string.h>
 #include "x86_format.h"
 #include "x86_register.h"
 #include "x86_register.inl"
@@ -18,6 +19,9 @@ const char* const x86_format::REG8[8] = { "AL", "CL", "DL", "BL", "SPL", "BPL",
 const char* const x86_format::REG16[8] = { "AX", "CX", "DX", "BX", "SP", "BP", "SI", "DI" };
 const char* const x86_format::REG32[8] = { "EAX", "ECX", "EDX", "EBX", "ESP", "EBP", "ESI", "EDI" };
 const char* const x86_format::REG64[8] = { "RAX", "RCX", "RDX", "RBX", "RSP", "RBP", "RSI", "RDI" };
+const char* const x86_format::SEGMENT[7] = { "", "CS", "SS", "DS", "ES", "FS", "GS" };
+//------------------------------------------------------------------------------
+static_assert(sizeof(x86_format::Packed) <= 32);
 //------------------------------------------------------------------------------
 void x86_format::Decode(Format& format, const uint8_t* opcode, const char* instruction, int offset, int immediate_size, int flags)
 {
@@ -399,3 +403,146 @@ void x86_format::Fixup(Format& format, x86_register& x86, x87_register& x87, mmx
     }
 }
 //------------------------------------------------------------------------------
+bool x86_format::Pack(const Format& format, Packed& packed)
+{
+    static const int widths[] = { 8, 16, 32, 64, 80 };
+    static const int addresses[] = { 16, 32, 64 };
+    static const int scales[] = { 0, 1, 2, 4, 8 };
+
+    auto code = [](const auto& table, int value) {
+        for (int i = 0; i < int(sizeof(table) / sizeof(table[0])); ++i) {
+            if (table[i] == value)
+                return i;
+        }
+        return -1;
+    };
+
+    packed = {};
+    packed.operation = format.operation;
+    packed.instruction = format.instruction;
+
+    int width = code(widths, format.width);
+    int address = code(addresses, format.address);
+    int segment = -1;
+    for (int i = 0; i < 7; ++i) {
+        if (strcmp(SEGMENT[i], format.segment) == 0)
+            segment = i;
+    }
+    if (width < 0 || address < 0 || segment < 0 || format.length < 1 || format.length > 15)
+        return false;
+    packed.length = format.length;
+    packed.address = address;
+    packed.repeatF2 = format.repeatF2;
+    packed.repeatF3 = format.repeatF3;
+    packed.width = width;
+    packed.segment = segment;
+
+    int slot = 0;
+    for (int i = 0; i < 3; ++i) {
+        auto& operand = format.operand[i];
+        int scale = code(scales, operand.scale);
+        if (scale < 0 || operand.index < -1 || operand.index > 7 || operand.base < -1 || operand.base > 7)
+            return false;
+        packed.operand[i].type = operand.type;
+        packed.operand[i].flags = operand.flags;
+        packed.operand[i].scale = scale;
+        packed.operand[i].index = scale ? operand.index : 0;
+        packed.operand[i].base = operand.base + 1;
+        if (operand.displacement) {
+            if (slot >= 2 || operand.displacement != int32_t(operand.displacement))
+                return false;
+            packed.operand[i].displacement = 1;
+            packed.displacement[slot++] = int32_t(operand.displacement);
+        }
+    }
+
+    return true;
+}
+//------------------------------------------------------------------------------
+void x86_format::Unpack(const Packed& packed, Format& format)
+{
+    static const char widths[] = { 8, 16, 32, 64, 80, 80, 80, 80 };
+    static const char addresses[] = { 16, 32, 64, 64 };
+    static const int8_t scales[] = { 0, 1, 2, 4, 8, 8, 8, 8 };
+
+    format.width = widths[packed.width];
+    format.length = packed.length;
+    format.address = addresses[packed.address];
+    format.repeatF2 = packed.repeatF2;
+    format.repeatF3 = packed.repeatF3;
+
+    int slot = 0;
+    for (int i = 0; i < 3; ++i) {
+        auto& operand = format.operand[i];
+        operand.type = Format::Operand::Type(packed.operand[i].type);
+        operand.flags = Format::Operand::Flag(packed.operand[i].flags);
+        operand.scale = scales[packed.operand[i].scale];
+        operand.index = operand.scale ? packed.operand[i].index : -1;
+        operand.base = packed.operand[i].base - 1;
+        operand.displacement = packed.operand[i].displacement ? packed.displacement[slot++] : 0;
+        operand.address = 0;
+        operand.memory = nullptr;
+    }
+
+    format.operation = packed.operation;
+    format.instruction = packed.instruction;
+    format.segment = SEGMENT[packed.segment];
+}
+//------------------------------------------------------------------------------
+void x86_format::Export(const Format& format, miCPU::Instruction& instruction)
+{
+    instruction.width = format.width;
+    instruction.size = format.address;
+    instruction.prefix = (format.repeatF2 ? 1 : 0) | (format.repeatF3 ? 2 : 0);
+    instruction.mnemonic = format.instruction;
+    instruction.segment = format.segment;
+    for (int i = 0; i < 3; ++i) {
+        auto& operand = instruction.operand[i];
+        operand.type = format.operand[i].type;
+        operand.flags = format.operand[i].flags;
+        operand.scale = format.operand[i].scale;
+        operand.index = format.operand[i].index;
+        operand.base = format.operand[i].base;
+        operand.displacement = format.operand[i].displacement;
+    }
+}
+//------------------------------------------------------------------------------
+void x86_format::Import(const miCPU::Instruction& instruction, Format& format)
+{
+    format.width = instruction.width;
+    format.length = instruction.length;
+    format.address = instruction.size;
+    format.repeatF2 = (instruction.prefix & 1) != 0;
+    format.repeatF3 = (instruction.prefix & 2) != 0;
+    format.instruction = instruction.mnemonic;
+    format.segment = instruction.segment;
+    for (int i = 0; i < 3; ++i) {
+        auto& operand = instruction.operand[i];
+        format.operand[i].type = Format::Operand::Type(operand.type);
+        format.operand[i].flags = Format::Operand::Flag(operand.flags);
+        format.operand[i].scale = operand.scale;
+        format.operand[i].index = operand.index;
+        format.operand[i].base = operand.base;
+        format.operand[i].displacement = decltype(format.operand[i].displacement)(operand.displacement);
+    }
+}
+//------------------------------------------------------------------------------
+std::string x86_format::Opcode(const miCPU::Instruction& instruction, const uint8_t* memory, size_t memory_size)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    char temp[8 + 3 + 32 + 1];
+    snprintf(temp, 12, "%08zX : ", instruction.address);
+    for (uint32_t i = 0; i < 16; ++i) {
+        if (i >= instruction.length || instruction.address + i >= memory_size) {
+            temp[11 + i * 2 + 0] = ' ';
+            temp[11 + i * 2 + 1] = ' ';
+            continue;
+        }
+        uint8_t value = memory[instruction.address + i];
+        temp[11 + i * 2 + 0] = hex[value >> 4];
+        temp[11 + i * 2 + 1] = hex[value & 15];
+    }
+    temp[8 + 3 + 32] = 0;
+    return temp;
+}
+//------------------------------------------------------------------------------
@@ -3,6 +3,8 @@
 #include <stdint.h>
 #include <string>
 
+#include "miCPU.h"
+
 #define HAVE_X64 0
 
 struct x86_register;
@@ -48,6 +50,31 @@ struct x86_format
         void (*operation)(x86_register&, x87_register&, mmx_register&, sse_register&, const Format&, void*, const void*, const void*) = nullptr;
     };
 
+    // 32 bytes, keeps every field read by Fixup, operation and Disasm
+    struct Packed
+    {
+        struct Operand
+        {
+            uint16_t type:3;
+            uint16_t flags:2;
+            uint16_t scale:3;           // 0, 1, 2, 4, 8 as 0 to 4
+            uint16_t index:3;
+            uint16_t base:4;            // base + 1
+            uint16_t displacement:1;    // next displacement slot
+        };
+
+        void (*operation)(x86_register&, x87_register&, mmx_register&, sse_register&, const Format&, void*, const void*, const void*);
+        const char* instruction;
+        int32_t displacement[2];
+        Operand operand[3];
+        uint8_t length:4;
+        uint8_t address:2;              // 16, 32, 64 as 0 to 2
+        uint8_t repeatF2:1;
+        uint8_t repeatF3:1;
+        uint8_t width:3;                // 8, 16, 32, 64, 80 as 0 to 4
+        uint8_t segment:3;
+    };
+
     enum
     {
         OPERAND_SIZE    = 0b0000001,
@@ -64,6 +91,11 @@ struct x86_format
     static void         Decode(Format& format, const uint8_t* opcode, const char* instruction, int offset = 0, int immediate_size = 0, int flags = 0);
     static std::string  Disasm(const Format& format, x86_register& x86, x87_register& x87, mmx_register& mmx, sse_register& sse);
     static void         Fixup(Format& format, x86_register& x86, x87_register& x87, mmx_register& mmx, sse_register& sse);
+    static bool         Pack(const Format& format, Packed& packed);
+    static void         Unpack(const Packed& packed, Format& format);
+    static void         Export(const Format& format, miCPU::Instruction& instruction);
+    static void         Import(const miCPU::Instruction& instruction, Format& format);
+    static std::string  Opcode(const miCPU::Instruction& instruction, const uint8_t* memory, size_t memory_size);
 
     typedef void instruction(Format&, const uint8_t*);
     typedef void (*instruction_pointer)(Format&, const uint8_t*);
@@ -73,4 +105,5 @@ struct x86_format
     static const char* const REG16[8];
     static const char* const REG32[8];
     static const char* const REG64[8];
+    static const char* const SEGMENT[7];
 };
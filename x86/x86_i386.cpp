@@ -5,6 +5,9 @@
 // INTEL CORPORATION 1987
 //==============================================================================
 #include <stdarg.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
 #include "x86_i386.h"
 #include "x86_register.h"
 #include "x86_register.inl"
@@ -130,6 +133,8 @@ const x86_instruction::instruction_pointer x86_i386::escMOD[8][8] =
 //------------------------------------------------------------------------------
 x86_i386::~x86_i386()
 {
+    if (JournalFile)
+        fclose(JournalFile);
     delete Allocator;
 }
 //------------------------------------------------------------------------------
@@ -153,20 +158,124 @@ bool x86_i386::Initialize(allocator_t* allocator, size_t stack)
 //------------------------------------------------------------------------------
 bool x86_i386::Run()
 {
-    if (BreakpointDataAddress || BreakpointProgram) {
-        while (EIP) {
-            if (Step('INTO') == false)
-                return false;
-            if (BreakpointDataAddress && BreakpointDataAddress < memory_size) {
-                if (memcmp(memory_address + BreakpointDataAddress, &BreakpointDataValue, sizeof(uint32_t)) == 0)
-                    return false;
+    ArmBreakpoints();
+    bool result = Step('LOOP');
+    Breakpointing = false;
+    return result;
+}
+//------------------------------------------------------------------------------
+int x86_i386::RunFor(size_t instructions, size_t microseconds, size_t* retired)
+{
+    auto& x86 = *(x86_register*)this;
+    auto& x87 = *(x87_register*)this;
+    auto& mmx = *(mmx_register*)Register('mmx ');
+    auto& sse = *(sse_register*)Register('sse ');
+
+    ArmBreakpoints();
+
+    // The clock is read once every 1024 instructions
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(microseconds);
+
+    int reason = RUN_COUNT;
+    size_t count = 0;
+    size_t clock = 1023;
+    auto eip = EIP;
+    while (count < instructions) {
+        if (microseconds && count >= clock) {
+            clock = count + 1024;
+            if (std::chrono::steady_clock::now() >= deadline) {
+                reason = RUN_DEADLINE;
+                break;
             }
-            if (BreakpointProgram == EIP)
-                return false;
         }
-        return true;
+        Format format;
+        auto next = EIP;
+        auto opcode = x86.opcode;
+        auto esp_step = ESP;
+        auto edi_step = EDI;
+#if HAVE_JIT
+        auto block = Breakpointing ? nullptr : Translate();
+        if (block && instructions - count >= block->count) {
+            block->entry(x86, memory_address);
+            opcode = memory_address + block->address;
+            count += block->count;
+        }
+        else
+#endif
+        {
+            auto decoded = Fetch(format);
+            next = EIP;
+            opcode = x86.opcode;
+            if (decoded && decoded->fusion != FUSION_NONE && Breakpointing == false && instructions - count >= decoded->count) {
+                Fused(*decoded, format);
+                count += decoded->count;
+            }
+            else {
+                Fixup(format, x86, x87, mmx, sse);
+                if (format.operation == nullptr) {
+                    EIP = eip;
+                    reason = RUN_FAULT;
+                    break;
+                }
+                format.operation(x86, x87, mmx, sse, format, format.operand[0].memory, format.operand[1].memory, format.operand[2].memory);
+                count++;
+            }
+        }
+        if (opcode[0] == 0xE8 || (opcode[0] == 0xFF && (opcode[1] & 0b00111000) == 0b00010000))    // CALL
+            CallLink(next);
+        else if (opcode[0] == 0xC2 || opcode[0] == 0xC3)    // RET
+            ReturnLink();
+        bool system = EIP >= memory_size;
+        if (system && Syscall() == false) {
+            EIP = eip;
+            reason = RUN_FAULT;
+            break;
+        }
+        if (EIP == 0) {
+            EIP = eip;
+            reason = RUN_EXIT;
+            break;
+        }
+        if (Breakpointing && Breakpoint(format, system || ESP < esp_step || EDI != edi_step)) {
+            reason = RUN_BREAKPOINT;
+            break;
+        }
+        eip = EIP;
     }
-    return Step('LOOP');
+    Breakpointing = false;
+
+    if (retired)
+        (*retired) = count;
+    return reason;
+}
+//------------------------------------------------------------------------------
+void x86_i386::ArmBreakpoints()
+{
+    BreakpointDataList.clear();
+    BreakpointProgramList.clear();
+    if (BreakpointDataAddress)
+        BreakpointDataList.emplace_back(uint32_t(BreakpointDataAddress), uint32_t(BreakpointDataValue));
+    for (auto [address, value] : BreakpointDatas)
+        BreakpointDataList.emplace_back(uint32_t(address), uint32_t(value));
+    if (BreakpointProgram)
+        BreakpointProgramList.push_back(uint32_t(BreakpointProgram));
+    for (auto address : BreakpointPrograms)
+        BreakpointProgramList.push_back(uint32_t(address));
+
+    // Pages holding a breakpoint are marked, the lists are only searched on a marked page
+    BreakpointPages.assign((memory_size + 4095) / 4096, 0);
+    std::erase_if(BreakpointDataList, [&](auto& data) { return data.first + sizeof(uint32_t) > memory_size; });
+    std::erase_if(BreakpointProgramList, [&](auto address) { return address >= memory_size; });
+    std::sort(BreakpointProgramList.begin(), BreakpointProgramList.end());
+    for (auto [address, value] : BreakpointDataList) {
+        BreakpointPages[address / 4096] |= BREAKPOINT_DATA;
+        BreakpointPages[(address + sizeof(uint32_t) - 1) / 4096] |= BREAKPOINT_DATA;
+    }
+    for (auto address : BreakpointProgramList) {
+        BreakpointPages[address / 4096] |= BREAKPOINT_PROGRAM;
+    }
+
+    Breakpointing = BreakpointDataList.empty() == false || BreakpointProgramList.empty() == false;
 }
 //------------------------------------------------------------------------------
 bool x86_i386::Step(int type)
@@ -181,20 +290,47 @@ bool x86_i386::Step(int type)
     auto esp = ESP;
     while (EIP) {
         Format format;
-        StepInternal(*this, format);
-        Fixup(format, x86, x87, mmx, sse);
-        if (format.operation == nullptr)
+        auto next = EIP;
+        auto opcode = x86.opcode;
+        auto esp_step = ESP;
+        auto edi_step = EDI;
+#if HAVE_JIT
+        auto block = (type == 'LOOP' && Breakpointing == false) ? Translate() : nullptr;
+        if (block) {
+            block->entry(x86, memory_address);
+            opcode = memory_address + block->address;
+        }
+        else
+#endif
+        {
+            auto decoded = Fetch(format);
+            next = EIP;
+            opcode = x86.opcode;
+            if (decoded && decoded->fusion != FUSION_NONE && type == 'LOOP' && Breakpointing == false) {
+                Fused(*decoded, format);
+            }
+            else {
+                Fixup(format, x86, x87, mmx, sse);
+                if (format.operation == nullptr)
+                    return false;
+                format.operation(x86, x87, mmx, sse, format, format.operand[0].memory, format.operand[1].memory, format.operand[2].memory);
+            }
+        }
+        if (opcode[0] == 0xE8 || (opcode[0] == 0xFF && (opcode[1] & 0b00111000) == 0b00010000))    // CALL
+            CallLink(next);
+        else if (opcode[0] == 0xC2 || opcode[0] == 0xC3)    // RET
+            ReturnLink();
+        bool system = EIP >= memory_size;
+        if (system && Syscall() == false) {
+            EIP = eip;
             return false;
-        format.operation(x86, x87, mmx, sse, format, format.operand[0].memory, format.operand[1].memory, format.operand[2].memory);
-        if (EIP >= memory_size) {
-            auto count = Exception(this, EIP);
-            EIP = Pop32();
-            ESP += count;
         }
         if (EIP == 0) {
             EIP = eip;
             return false;
         }
+        if (Breakpointing && Breakpoint(format, system || ESP < esp_step || EDI != edi_step))
+            return false;
         switch (type) {
         case 'INTO':
             return true;
@@ -203,7 +339,7 @@ bool x86_i386::Step(int type)
                 return true;
             break;
         case 'OUT ':
-            if (strcmp(format.instruction, "RET") == 0)
+            if (opcode[0] == 0xC2 || opcode[0] == 0xC3)     // RET
                 return true;
             break;
         }
@@ -212,6 +348,407 @@ bool x86_i386::Step(int type)
     return true;
 }
 //------------------------------------------------------------------------------
+bool x86_i386::Breakpoint(const Format& format, bool implicit) const
+{
+    auto& x86 = *(x86_register*)this;
+
+    // Data is compared after a store into a marked page, and after the stores
+    // without an explicit operand (system calls, pushes moving ESP down and
+    // string stores moving EDI)
+    bool data = implicit;
+    for (int i = 0; i < 3 && BreakpointDataList.empty() == false; ++i) {
+        if (format.operand[i].type != Format::Operand::ADR)
+            continue;
+        size_t page = format.operand[i].address / 4096;
+        if (page < BreakpointPages.size() && (BreakpointPages[page] & BREAKPOINT_DATA))
+            data = true;
+    }
+    if (data) {
+        for (auto& [address, value] : BreakpointDataList) {
+            if (memcmp(memory_address + address, &value, sizeof(uint32_t)) == 0)
+                return true;
+        }
+    }
+
+    size_t page = EIP / 4096;
+    if (page < BreakpointPages.size() && (BreakpointPages[page] & BREAKPOINT_PROGRAM)) {
+        if (std::binary_search(BreakpointProgramList.begin(), BreakpointProgramList.end(), EIP))
+            return true;
+    }
+
+    return false;
+}
+//------------------------------------------------------------------------------
+const x86_i386::Decoded* x86_i386::Fetch(Format& format)
+{
+    auto& x86 = *(x86_register*)this;
+
+    if (DecodedCache.empty())
+        DecodedCache.resize(DECODED_CACHE);
+
+    auto address = EIP;
+    auto& decoded = DecodedCache[address % DECODED_CACHE];
+    if (decoded.address == address && address + decoded.length <= memory_size && memcmp(decoded.code, memory_address + address, decoded.length) == 0) {
+        Unpack(decoded.packed[0], format);
+        x86.opcode = memory_address + address + decoded.prefix;
+        EIP = address + decoded.packed[0].length;
+        return &decoded;
+    }
+
+    // Instructions which cannot be packed are decoded every time
+    decoded.address = 0;
+    StepInternal(*this, format);
+    if (format.operation == nullptr || EIP > memory_size || Pack(format, decoded.packed[0]) == false)
+        return nullptr;
+
+    decoded.address = address;
+    decoded.length = uint8_t(EIP - address);
+    decoded.count = 1;
+    decoded.fusion = FUSION_NONE;
+    decoded.prefix = uint8_t(x86.opcode - (memory_address + address));
+    memcpy(decoded.code, memory_address + address, decoded.length);
+    Fuse(decoded);
+    return &decoded;
+}
+//------------------------------------------------------------------------------
+void x86_i386::Fuse(Decoded& decoded)
+{
+    auto& x86 = *(x86_register*)this;
+
+    if (decoded.prefix)
+        return;
+
+    const uint8_t* code = memory_address + decoded.address;
+    size_t available = memory_size - decoded.address;
+    if (available > sizeof(decoded.code))
+        available = sizeof(decoded.code);
+
+    // PUSH and POP runs of prologues and epilogues, ESP itself is never part of a run
+    if ((code[0] & 0xF0) == 0x50 && (code[0] & 0b111) != 4) {
+        int count = 0;
+        while (count < 8 && count < int(available) && (code[count] & 0xF8) == (code[0] & 0xF8) && (code[count] & 0b111) != 4) {
+            decoded.registers[count] = code[count] & 0b111;
+            count++;
+        }
+        if (count >= 2) {
+            decoded.fusion = (code[0] < 0x58) ? FUSION_PUSH : FUSION_POP;
+            decoded.count = count;
+            decoded.length = count;
+            memcpy(decoded.code, code, count);
+        }
+        return;
+    }
+
+    // CMP or TEST followed by Jcc, MOV reg,[mem] followed by an ALU instruction
+    if (available < 2)
+        return;
+    int nnn = (code[1] >> 3) & 0b111;
+    bool compare = (code[0] >= 0x38 && code[0] <= 0x3D) || code[0] == 0x84 || code[0] == 0x85 || code[0] == 0xA8 || code[0] == 0xA9 ||
+                   ((code[0] == 0x80 || code[0] == 0x81 || code[0] == 0x83) && nnn == 7);
+    bool load = (code[0] == 0x8A || code[0] == 0x8B) && (code[1] >> 6) != 0b11;
+    if (compare == false && load == false)
+        return;
+
+    const uint8_t* second = code + decoded.length;
+    if (size_t(decoded.length) + 2 > available)
+        return;
+    bool branch = (second[0] & 0xF0) == 0x70 || (second[0] == 0x0F && (second[1] & 0xF0) == 0x80);
+    bool alu = (second[0] < 0x40 && (second[0] & 0b111) < 6) || second[0] == 0x80 || second[0] == 0x81 || second[0] == 0x83;
+    if ((compare && branch) == false && (load && alu) == false)
+        return;
+
+    auto eip = EIP;
+    auto opcode = x86.opcode;
+    Format format;
+    StepInternal(*this, format);
+    size_t length = EIP - decoded.address;
+    if (format.operation && length <= available && Pack(format, decoded.packed[1])) {
+        decoded.fusion = FUSION_PAIR;
+        decoded.count = 2;
+        decoded.length = uint8_t(length);
+        memcpy(decoded.code, code, length);
+    }
+    EIP = eip;
+    x86.opcode = opcode;
+}
+//------------------------------------------------------------------------------
+void x86_i386::Fused(const Decoded& decoded, Format& format)
+{
+    auto& x86 = *(x86_register*)this;
+    auto& x87 = *(x87_register*)this;
+    auto& mmx = *(mmx_register*)Register('mmx ');
+    auto& sse = *(sse_register*)Register('sse ');
+
+    switch (decoded.fusion) {
+    case FUSION_PAIR: {
+        // Flags are still written, a later instruction may read them
+        Fixup(format, x86, x87, mmx, sse);
+        format.operation(x86, x87, mmx, sse, format, format.operand[0].memory, format.operand[1].memory, format.operand[2].memory);
+        Format second;
+        Unpack(decoded.packed[1], second);
+        x86.opcode = x86.memory_address + EIP;
+        EIP += second.length;
+        Fixup(second, x86, x87, mmx, sse);
+        second.operation(x86, x87, mmx, sse, second, second.operand[0].memory, second.operand[1].memory, second.operand[2].memory);
+        break;
+    }
+    case FUSION_PUSH:
+        for (int i = 0; i < decoded.count; ++i) {
+            *(uint32_t*)(x86.memory_address + ESP - (i + 1) * sizeof(uint32_t)) = x86.regs[decoded.registers[i]].d;
+        }
+        x86.regs[4].q -= decoded.count * sizeof(uint32_t);
+        x86.stack_address = x86.memory_address + ESP;
+        EIP = decoded.address + decoded.length;
+        break;
+    case FUSION_POP:
+        for (int i = 0; i < decoded.count; ++i) {
+            x86.regs[decoded.registers[i]].d = *(uint32_t*)(x86.memory_address + ESP + i * sizeof(uint32_t));
+        }
+        x86.regs[4].q += decoded.count * sizeof(uint32_t);
+        x86.stack_address = x86.memory_address + ESP - sizeof(uint32_t);
+        EIP = decoded.address + decoded.length;
+        break;
+    }
+}
+//------------------------------------------------------------------------------
+void x86_i386::CallLink(uint32_t next)
+{
+    // The return site is kept aside while the callee may evict it from the cache
+    auto& link = ReturnStack[ReturnTop++ % RETURN_STACK];
+    auto& decoded = DecodedCache[next % DECODED_CACHE];
+    if (decoded.address == next) {
+        link = decoded;
+    }
+    else {
+        link.address = 0;
+    }
+}
+//------------------------------------------------------------------------------
+void x86_i386::ReturnLink()
+{
+    auto& x86 = *(x86_register*)this;
+
+    // A mispredicted return is looked up as usual
+    auto& link = ReturnStack[--ReturnTop % RETURN_STACK];
+    if (link.address != EIP || DecodedCache.empty())
+        return;
+    auto& decoded = DecodedCache[EIP % DECODED_CACHE];
+    if (decoded.address != EIP) {
+        decoded = link;
+    }
+}
+//------------------------------------------------------------------------------
+static const char JournalMagic[4] = { 'm', 'i', 'J', '2' };
+//------------------------------------------------------------------------------
+static void JournalWrite(FILE* file, uint32_t value)
+{
+    // LEB128, most of the values are small indices and counts
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        fputc(value ? byte | 0x80 : byte, file);
+    } while (value);
+}
+//------------------------------------------------------------------------------
+static bool JournalRead(FILE* file, uint32_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int byte = fgetc(file);
+        if (byte == EOF)
+            return false;
+        value |= uint32_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+//------------------------------------------------------------------------------
+bool x86_i386::Journal(const char* path, int mode)
+{
+    if (JournalFile) {
+        fclose(JournalFile);
+        JournalFile = nullptr;
+    }
+    JournalMode = JOURNAL_OFF;
+
+    switch (mode) {
+    case JOURNAL_RECORD:
+        JournalFile = fopen(path, "wb");
+        if (JournalFile == nullptr)
+            return false;
+        fwrite(JournalMagic, 1, sizeof(JournalMagic), JournalFile);
+        break;
+    case JOURNAL_REPLAY: {
+        char magic[sizeof(JournalMagic)] = {};
+        JournalFile = fopen(path, "rb");
+        if (JournalFile == nullptr)
+            return false;
+        if (fread(magic, 1, sizeof(magic), JournalFile) != sizeof(magic) || memcmp(magic, JournalMagic, sizeof(magic)) != 0) {
+            fclose(JournalFile);
+            JournalFile = nullptr;
+            return false;
+        }
+        break;
+    }
+    default:
+        return true;
+    }
+
+    JournalMode = mode;
+    return true;
+}
+//------------------------------------------------------------------------------
+static size_t JournalClamp(size_t address, size_t size, size_t memory_size)
+{
+    if (address + size > memory_size)
+        size = address < memory_size ? memory_size - address : 0;
+    return size;
+}
+//------------------------------------------------------------------------------
+bool x86_i386::JournalRegions(int regions, const size_t* writes)
+{
+    // Recorded : count [address size bytes]...
+    // Replayed : the addresses come from the call executed again, only the sizes have to agree
+    if (JournalMode == JOURNAL_RECORD) {
+        JournalWrite(JournalFile, regions);
+        for (int i = 0; i < regions; ++i) {
+            size_t address = writes[i * 2 + 0];
+            size_t size = JournalClamp(address, writes[i * 2 + 1], memory_size);
+            JournalWrite(JournalFile, uint32_t(address));
+            JournalWrite(JournalFile, uint32_t(size));
+            fwrite(memory_address + address, 1, size, JournalFile);
+        }
+        return true;
+    }
+
+    uint32_t count = 0;
+    if (JournalRead(JournalFile, count) == false || (writes && count != uint32_t(regions)))
+        return false;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t address = 0;
+        uint32_t size = 0;
+        if (JournalRead(JournalFile, address) == false || JournalRead(JournalFile, size) == false)
+            return false;
+        if (writes) {
+            address = uint32_t(writes[i * 2 + 0]);
+            if (JournalClamp(address, writes[i * 2 + 1], memory_size) != size)
+                return false;
+        }
+        if (size_t(address) + size > memory_size)
+            return false;
+        if (fread(memory_address + address, 1, size, JournalFile) != size)
+            return false;
+    }
+    return true;
+}
+//------------------------------------------------------------------------------
+bool x86_i386::Syscall()
+{
+    auto& x86 = *(x86_register*)this;
+
+    // Each call is one entry : (index << 2 | kind) then
+    //   JOURNAL_RESULT  : EAX EDX count regions, the host is not called on replay
+    //   JOURNAL_EXECUTE : regions, the host is called again and the regions are restored
+    //   JOURNAL_UNKNOWN : nothing, replay stops
+    size_t index = EIP;
+    size_t count = 0;
+    size_t writes[JOURNAL_REGIONS * 2];
+    if (JournalMode == JOURNAL_REPLAY) {
+        uint32_t entry = 0;
+        if (JournalRead(JournalFile, entry) == false || (entry >> 2) != (uint32_t(-index) & 0x3FFFFFFF))
+            return false;
+        switch (entry & 0b11) {
+        case JOURNAL_LIVE:
+            count = Exception(this, index);
+            break;
+        case JOURNAL_RESULT: {
+            uint32_t eax = 0;
+            uint32_t edx = 0;
+            uint32_t pop = 0;
+            if (JournalRead(JournalFile, eax) == false || JournalRead(JournalFile, edx) == false ||
+                JournalRead(JournalFile, pop) == false || JournalRegions(0, nullptr) == false)
+                return false;
+            EAX = eax;
+            EDX = edx;
+            count = pop;
+            break;
+        }
+        case JOURNAL_EXECUTE: {
+            count = Exception(this, index);
+            int effect = Effect(this, index, writes) - EFFECT_EXECUTE;
+            if (effect < 0 || JournalRegions(std::min<int>(effect, JOURNAL_REGIONS), writes) == false)
+                return false;
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    else {
+        count = Exception(this, index);
+        if (JournalMode == JOURNAL_RECORD) {
+            int effect = Effect(this, index, writes);
+            int kind = JOURNAL_LIVE;
+            if (effect == EFFECT_UNKNOWN)
+                kind = JOURNAL_UNKNOWN;
+            else if (effect >= EFFECT_EXECUTE)
+                kind = JOURNAL_EXECUTE;
+            else if (effect >= 0)
+                kind = JOURNAL_RESULT;
+            JournalWrite(JournalFile, uint32_t(-index) << 2 | kind);
+            switch (kind) {
+            case JOURNAL_RESULT:
+                JournalWrite(JournalFile, EAX);
+                JournalWrite(JournalFile, EDX);
+                JournalWrite(JournalFile, uint32_t(count));
+                JournalRegions(std::min<int>(effect, JOURNAL_REGIONS), writes);
+                break;
+            case JOURNAL_EXECUTE:
+                JournalRegions(std::min<int>(effect - EFFECT_EXECUTE, JOURNAL_REGIONS), writes);
+                break;
+            }
+        }
+    }
+
+    EIP = Pop32();
+    ESP += count;
+    ReturnLink();
+    return true;
+}
+//------------------------------------------------------------------------------
+#if HAVE_JIT
+const x86_jit::Block* x86_i386::Translate()
+{
+    auto& x86 = *(x86_register*)this;
+
+    if (EIP == 0 || EIP >= memory_size)
+        return nullptr;
+    auto block = Translator.Find(EIP, memory_address);
+    if (block == nullptr || block->entry)
+        return block;
+
+    // Hot block, instructions the translator does not know end it and are left to the interpreter
+    auto eip = EIP;
+    auto opcode = x86.opcode;
+    Translator.Begin();
+    while (Translator.Terminated() == false && EIP - eip <= x86_jit::BLOCK_BYTES - 16) {
+        Format format;
+        auto address = EIP;
+        StepInternal(*this, format);
+        if (format.operation == nullptr || EIP > memory_size || x86.opcode != memory_address + address ||
+            Translator.Emit(format, x86.opcode, address) == false) {
+            EIP = address;
+            break;
+        }
+    }
+    bool translated = Translator.End(*block, EIP, memory_address);
+    EIP = eip;
+    x86.opcode = opcode;
+    return translated ? block : nullptr;
+}
+#endif
+//------------------------------------------------------------------------------
 bool x86_i386::Jump(size_t address)
 {
     if (address > memory_size)
@@ -357,6 +894,55 @@ std::string x86_i386::Disassemble(int count) const
     return output;
 }
 //------------------------------------------------------------------------------
+size_t x86_i386::Disassemble(size_t begin, size_t end, std::vector<Instruction>& instructions) const
+{
+    if (end > memory_size)
+        end = memory_size;
+    if (begin >= end)
+        return 0;
+
+    // One decoder for the whole range, the text is rendered on demand
+    x86_i386 x86(StepInternal);
+    x86.memory_size = memory_size;
+    x86.memory_address = memory_address;
+
+    size_t count = instructions.size();
+    instructions.reserve(count + (end - begin) / 4);
+
+    EIP = (uint32_t)begin;
+    while (EIP < end) {
+        Instruction instruction;
+        instruction.address = EIP;
+
+        Format format;
+        x86.StepInternal(x86, format);
+
+        instruction.length = uint8_t(EIP - instruction.address);
+        Export(format, instruction);
+        instructions.push_back(instruction);
+    }
+
+    return instructions.size() - count;
+}
+//------------------------------------------------------------------------------
+std::string x86_i386::Disassemble(const Instruction& instruction) const
+{
+    Format format;
+    Import(instruction, format);
+
+    // Relative operands are resolved against the next instruction
+    x86_register x86;
+    EIP = uint32_t(instruction.address + instruction.length);
+
+    auto& x87 = *(x87_register*)Register('x87 ');
+    auto& mmx = *(mmx_register*)Register('mmx ');
+    auto& sse = *(sse_register*)Register('sse ');
+
+    std::string output = Opcode(instruction, memory_address, memory_size);
+    output += Disasm(format, x86, x87, mmx, sse);
+    return output;
+}
+//------------------------------------------------------------------------------
 void x86_i386::StepImplement(x86_i386& x86, Format& format)
 {
     format.width = 32;
@@ -6,9 +6,12 @@
 //==============================================================================
 #pragma once
 
+#include <stdio.h>
+
 #include "miCPU.h"
 
 #include "x86_instruction.h"
+#include "x86_jit.h"
 #include "x87_instruction.h"
 
 struct x86_i386 : public miCPU
@@ -20,6 +23,7 @@ public:
     virtual ~x86_i386();
     bool Initialize(allocator_t* allocator, size_t stack) override;
     bool Run() override;
+    int RunFor(size_t instructions, size_t microseconds, size_t* retired = nullptr) override;
     bool Step(int type) override;
     bool Jump(size_t address) override;
     uint8_t* Memory(size_t base = 0, size_t size = 0) const override;
@@ -28,12 +32,79 @@ public:
     size_t Program() const override;
     std::string Status() const override;
     std::string Disassemble(int count) const override;
+    size_t Disassemble(size_t begin, size_t end, std::vector<Instruction>& instructions) const override;
+    std::string Disassemble(const Instruction& instruction) const override;
+
+    enum { JOURNAL_OFF, JOURNAL_RECORD, JOURNAL_REPLAY };
+    bool Journal(const char* path, int mode);
 
 protected:
     static void StepImplement(x86_i386& x86, Format& format);
 
     void (*StepInternal)(x86_i386& x86, Format& format) = nullptr;
 
+protected:
+    enum { BREAKPOINT_PROGRAM = 1, BREAKPOINT_DATA = 2 };
+
+    void ArmBreakpoints();
+    bool Breakpoint(const Format& format, bool implicit) const;
+
+    std::vector<std::pair<uint32_t, uint32_t>> BreakpointDataList;
+    std::vector<uint32_t> BreakpointProgramList;
+    std::vector<uint8_t> BreakpointPages;
+    bool Breakpointing = false;
+
+protected:
+    enum { DECODED_CACHE = 2048 };
+    enum { FUSION_NONE, FUSION_PAIR, FUSION_PUSH, FUSION_POP };
+
+    // Decoded instructions, validated against the guest bytes on every hit
+    struct Decoded
+    {
+        uint32_t address;
+        uint8_t length;         // Bytes of the whole entry
+        uint8_t count;          // Instructions of the whole entry
+        uint8_t fusion;
+        uint8_t prefix;         // Prefix bytes of the first instruction
+        uint8_t registers[8];   // PUSH and POP runs
+        uint8_t code[32];
+        Packed packed[2];
+    };
+
+    const Decoded* Fetch(Format& format);
+    void Fuse(Decoded& decoded);
+    void Fused(const Decoded& decoded, Format& format);
+
+    std::vector<Decoded> DecodedCache;
+
+protected:
+    enum { RETURN_STACK = 16 };
+
+    void CallLink(uint32_t next);
+    void ReturnLink();
+
+    // Shadow of the guest return addresses, each with the decoded return site
+    Decoded ReturnStack[RETURN_STACK] = {};
+    uint32_t ReturnTop = 0;
+
+protected:
+    enum { JOURNAL_REGIONS = 4 };
+    enum { JOURNAL_LIVE, JOURNAL_RESULT, JOURNAL_EXECUTE, JOURNAL_UNKNOWN };
+
+    bool Syscall();
+    bool JournalRegions(int regions, const size_t* writes);
+
+    // Results of the calls which read host state, fed back in the same order on replay
+    FILE* JournalFile = nullptr;
+    int JournalMode = JOURNAL_OFF;
+
+#if HAVE_JIT
+protected:
+    const x86_jit::Block* Translate();
+
+    x86_jit Translator;
+#endif
+
 protected:
     static instruction ESC;
     static instruction TWO;
@@ -5,6 +5,7 @@
 // Intel Corporation 1978, 1979
 //==============================================================================
 #include <stdarg.h>
+#include <chrono>
 #include "x86_i86.h"
 #include "x86_register.h"
 #include "x86_register.inl"
@@ -94,6 +95,56 @@ bool x86_i86::Run()
     return Step('LOOP');
 }
 //------------------------------------------------------------------------------
+int x86_i86::RunFor(size_t instructions, size_t microseconds, size_t* retired)
+{
+    auto& x86 = *(x86_register*)this;
+    auto& x87 = *(x87_register*)this;
+    auto& mmx = *(mmx_register*)Register('mmx ');
+    auto& sse = *(sse_register*)Register('sse ');
+
+    // The clock is read once every 1024 instructions
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(microseconds);
+
+    int reason = RUN_COUNT;
+    size_t count = 0;
+    auto ip = IP;
+    while (count < instructions) {
+        if (microseconds && (count & 1023) == 1023 && std::chrono::steady_clock::now() >= deadline) {
+            reason = RUN_DEADLINE;
+            break;
+        }
+        Format format;
+        StepInternal(format);
+        Fixup(format, x86, x87, mmx, sse);
+        if (format.operation == nullptr) {
+            IP = ip;
+            reason = RUN_FAULT;
+            break;
+        }
+        format.operation(x86, x87, mmx, sse, format, format.operand[0].memory, format.operand[1].memory, format.operand[2].memory);
+        count++;
+        if (IP >= memory_size) {
+            auto count = (uint16_t)Exception(this, IP);
+            IP = Pop16();
+            SP += count;
+        }
+        if (IP == 0) {
+            IP = ip;
+            reason = RUN_EXIT;
+            break;
+        }
+        if (BreakpointProgram == IP) {
+            reason = RUN_BREAKPOINT;
+            break;
+        }
+        ip = IP;
+    }
+
+    if (retired)
+        (*retired) = count;
+    return reason;
+}
+//------------------------------------------------------------------------------
 bool x86_i86::Step(int type)
 {
     auto& x86 = *(x86_register*)this;
@@ -110,6 +161,7 @@ bool x86_i86::Step(int type)
         Fixup(format, x86, x87, mmx, sse);
         if (format.operation == nullptr)
             return false;
+        auto opcode = x86.opcode;
         format.operation(x86, x87, mmx, sse, format, format.operand[0].memory, format.operand[1].memory, format.operand[2].memory);
         if (IP >= memory_size) {
             auto count = (uint16_t)Exception(this, IP);
@@ -128,7 +180,7 @@ bool x86_i86::Step(int type)
                 return true;
             break;
         case 'OUT ':
-            if (strcmp(format.instruction, "RET") == 0)
+            if (opcode[0] == 0xC2 || opcode[0] == 0xC3)     // RET
                 return true;
             break;
         }
@@ -283,6 +335,57 @@ std::string x86_i86::Disassemble(int count) const
     return output;
 }
 //------------------------------------------------------------------------------
+size_t x86_i86::Disassemble(size_t begin, size_t end, std::vector<Instruction>& instructions) const
+{
+    if (end > memory_size)
+        end = memory_size;
+    if (end > 0x10000)
+        end = 0x10000;
+    if (begin >= end)
+        return 0;
+
+    // One decoder for the whole range, the text is rendered on demand
+    x86_i86 x86;
+    x86.memory_size = memory_size;
+    x86.memory_address = memory_address;
+
+    size_t count = instructions.size();
+    instructions.reserve(count + (end - begin) / 4);
+
+    for (size_t address = begin; address < end; address += instructions.back().length) {
+        Instruction instruction;
+        instruction.address = address;
+
+        Format format;
+        IP = (uint16_t)address;
+        x86.StepInternal(format);
+
+        instruction.length = uint8_t(IP - uint16_t(address));
+        Export(format, instruction);
+        instructions.push_back(instruction);
+    }
+
+    return instructions.size() - count;
+}
+//------------------------------------------------------------------------------
+std::string x86_i86::Disassemble(const Instruction& instruction) const
+{
+    Format format;
+    Import(instruction, format);
+
+    // Relative operands are resolved against the next instruction
+    x86_register x86;
+    IP = uint16_t(instruction.address + instruction.length);
+
+    auto& x87 = *(x87_register*)Register('x87 ');
+    auto& mmx = *(mmx_register*)Register('mmx ');
+    auto& sse = *(sse_register*)Register('sse ');
+
+    std::string output = Opcode(instruction, memory_address, memory_size);
+    output += Disasm(format, x86, x87, mmx, sse);
+    return output;
+}
+//------------------------------------------------------------------------------
 void x86_i86::StepInternal(Format& format)
 {
     format.width = 16;
@@ -19,6 +19,7 @@ public:
     virtual ~x86_i86();
     bool Initialize(allocator_t* allocator, size_t stack) override;
     bool Run() override;
+    int RunFor(size_t instructions, size_t microseconds, size_t* retired = nullptr) override;
     bool Step(int type) override;
     bool Jump(size_t address) override;
     uint8_t* Memory(size_t base = 0, size_t size = 0) const override;
@@ -27,6 +28,8 @@ public:
     size_t Program() const override;
     std::string Status() const override;
     std::string Disassemble(int count) const override;
+    size_t Disassemble(size_t begin, size_t end, std::vector<Instruction>& instructions) const override;
+    std::string Disassemble(const Instruction& instruction) const override;
 
 protected:
     void StepInternal(Format& format);
@@ -0,0 +1,344 @@
+#include <stddef.h>
+#include <string.h>
+#include "x86_jit.h"
+#include "x86_register.h"
+
+#if HAVE_JIT
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// Guest registers live in R8D to R15D, RDI holds x86_register and RSI the guest memory
+#define HOST(reg)       (8 + (reg))
+#define NONE            (-1)
+#define EAX             0
+#define ECX             1
+#define REGS            uint32_t(offsetof(x86_register, regs))
+#define IP              uint32_t(offsetof(x86_register, ip))
+#define FLAGS           uint32_t(offsetof(x86_register, flags))
+#define ARITHMETIC      0x8D5   // OF SF ZF AF PF CF
+
+//------------------------------------------------------------------------------
+static void Bytes(std::vector<uint8_t>& code, std::initializer_list<uint8_t> bytes)
+{
+    code.insert(code.end(), bytes);
+}
+//------------------------------------------------------------------------------
+static void Dword(std::vector<uint8_t>& code, uint32_t value)
+{
+    Bytes(code, { uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16), uint8_t(value >> 24) });
+}
+//------------------------------------------------------------------------------
+// op r/m32, where r/m is a host register or [RSI+RAX] when rm is NONE, and reg is a host register or an opcode extension
+static void Op(std::vector<uint8_t>& code, uint8_t op, int reg, int rm)
+{
+    uint8_t rex = 0x40;
+    if (reg & 8)                rex |= 0b0100;
+    if (rm != NONE && (rm & 8)) rex |= 0b0001;
+    if (rex != 0x40)
+        code.push_back(rex);
+    code.push_back(op);
+    if (rm != NONE) {
+        code.push_back(0b11000000 | (reg & 7) << 3 | (rm & 7));
+    }
+    else {
+        code.push_back(0b00000100 | (reg & 7) << 3);
+        code.push_back(0b00000110);
+    }
+}
+//------------------------------------------------------------------------------
+// LEA dest32, [base + index * scale + displacement], wrapping at 4GB like Fixup
+static void Address(std::vector<uint8_t>& code, int dest, int base, int index, int scale, int32_t displacement)
+{
+    uint8_t rex = 0x40;
+    if (dest & 8)                       rex |= 0b0100;
+    if (index != NONE && (index & 8))   rex |= 0b0010;
+    if (base != NONE && (base & 8))     rex |= 0b0001;
+    if (rex != 0x40)
+        code.push_back(rex);
+    code.push_back(0x8D);
+    code.push_back((base != NONE ? 0b10000000 : 0) | (dest & 7) << 3 | 0b100);
+    int ss = (scale == 8) ? 3 : (scale == 4) ? 2 : (scale == 2) ? 1 : 0;
+    code.push_back(ss << 6 | (index != NONE ? index & 7 : 0b100) << 3 | (base != NONE ? base & 7 : 0b101));
+    Dword(code, displacement);
+}
+//------------------------------------------------------------------------------
+static void Address(std::vector<uint8_t>& code, int dest, const x86_format::Format::Operand& operand)
+{
+    int base = (operand.base >= 0) ? HOST(operand.base) : NONE;
+    int index = (operand.scale > 0) ? HOST(operand.index) : NONE;
+    Address(code, dest, base, index, operand.scale, operand.displacement);
+}
+//------------------------------------------------------------------------------
+x86_jit::~x86_jit()
+{
+    if (Code == nullptr)
+        return;
+#if defined(_WIN32)
+    VirtualFree(Code, 0, MEM_RELEASE);
+#else
+    munmap(Code, CODE_SIZE);
+#endif
+}
+//------------------------------------------------------------------------------
+x86_jit::Block* x86_jit::Find(uint32_t address, const uint8_t* memory)
+{
+    if (Blocks.empty())
+        Blocks.resize(BLOCK_CACHE);
+
+    auto& block = Blocks[address % BLOCK_CACHE];
+    if (block.address != address || memcmp(block.guest, memory + address, block.length) != 0) {
+        block.address = address;
+        block.hits = 0;
+        block.length = 0;
+        block.count = 0;
+        block.entry = nullptr;
+    }
+    if (block.entry)
+        return &block;
+
+    // A block is translated once, when it becomes hot
+    return (++block.hits == BLOCK_HOT) ? &block : nullptr;
+}
+//------------------------------------------------------------------------------
+void x86_jit::Begin()
+{
+    Buffer.clear();
+    Count = 0;
+    Ended = false;
+
+    auto& code = Buffer;
+    Bytes(code, { 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57 });    // PUSH R12-R15
+#if defined(_WIN32)
+    Bytes(code, { 0x57, 0x56 });                                        // PUSH RDI, RSI
+    Bytes(code, { 0x48, 0x89, 0xCF, 0x48, 0x89, 0xD6 });                // MOV RDI, RCX / MOV RSI, RDX
+#endif
+    for (int i = 0; i < 8; ++i) {
+        Bytes(code, { 0x44, 0x8B, uint8_t(0x87 | i << 3) });           // MOV R8D+i, [RDI+REGS+i*8]
+        Dword(code, REGS + i * sizeof(x86_register::register_t));
+    }
+
+    // The guest arithmetic flags are carried in the host flags through the block
+    Bytes(code, { 0x9C, 0x58 });                                        // PUSHFQ / POP RAX
+    Bytes(code, { 0x25 });                                              // AND EAX, ~ARITHMETIC
+    Dword(code, ~ARITHMETIC);
+    Bytes(code, { 0x8B, 0x8F });                                        // MOV ECX, [RDI+FLAGS]
+    Dword(code, FLAGS);
+    Bytes(code, { 0x81, 0xE1 });                                        // AND ECX, ARITHMETIC
+    Dword(code, ARITHMETIC);
+    Bytes(code, { 0x09, 0xC8, 0x50, 0x9D });                            // OR EAX, ECX / PUSH RAX / POPFQ
+}
+//------------------------------------------------------------------------------
+bool x86_jit::Emit(const x86_format::Format& format, const uint8_t* opcode, uint32_t address)
+{
+    auto& code = Buffer;
+    uint32_t next = address + format.length;
+
+    // Jcc and JMP end the block, the host condition codes are the guest ones
+    int condition = -1;
+    uint32_t target = 0;
+    switch (opcode[0]) {
+    case 0x70: case 0x71: case 0x72: case 0x73: case 0x74: case 0x75: case 0x76: case 0x77:
+    case 0x78: case 0x79: case 0x7A: case 0x7B: case 0x7C: case 0x7D: case 0x7E: case 0x7F:
+        condition = opcode[0] & 0xF;
+        target = next + int8_t(opcode[1]);
+        break;
+    case 0x0F:
+        if ((opcode[1] & 0xF0) != 0x80)
+            return false;
+        condition = opcode[1] & 0xF;
+        target = next + *(int32_t*)(opcode + 2);
+        break;
+    case 0xEB:
+        target = next + int8_t(opcode[1]);
+        break;
+    case 0xE9:
+        target = next + *(int32_t*)(opcode + 1);
+        break;
+    default:
+        break;
+    }
+    switch (opcode[0]) {
+    case 0x70: case 0x71: case 0x72: case 0x73: case 0x74: case 0x75: case 0x76: case 0x77:
+    case 0x78: case 0x79: case 0x7A: case 0x7B: case 0x7C: case 0x7D: case 0x7E: case 0x7F:
+    case 0x0F:
+        Bytes(code, { 0x0F, uint8_t(0x80 | condition) });               // Jcc taken
+        Dword(code, 10 + 5);
+        Bytes(code, { 0xC7, 0x87 });                                    // MOV [RDI+IP], next
+        Dword(code, IP);
+        Dword(code, next);
+        Bytes(code, { 0xE9 });                                          // JMP exit
+        Dword(code, 10);
+        [[fallthrough]];
+    case 0xEB:
+    case 0xE9:
+        Bytes(code, { 0xC7, 0x87 });                                    // taken: MOV [RDI+IP], target
+        Dword(code, IP);
+        Dword(code, target);
+        Count++;
+        Ended = true;
+        return true;
+    }
+
+    if (format.width != 32 || format.address != 32)
+        return false;
+
+    int reg = (opcode[1] >> 3) & 0b111;
+    int rm = ((opcode[1] >> 6) == 0b11) ? HOST(opcode[1] & 0b111) : NONE;
+    const x86_format::Format::Operand* memory = nullptr;
+    for (auto& operand : format.operand) {
+        if (operand.type == x86_format::Format::Operand::ADR)
+            memory = &operand;
+    }
+    switch (opcode[0]) {
+    case 0x01: case 0x09: case 0x11: case 0x19: case 0x21: case 0x29: case 0x31: case 0x39:
+    case 0x03: case 0x0B: case 0x13: case 0x1B: case 0x23: case 0x2B: case 0x33: case 0x3B:
+    case 0x85:  // TEST
+    case 0x89:  // MOV
+    case 0x8B:
+        if (rm == NONE && memory == nullptr)
+            return false;
+        if (rm == NONE)
+            Address(code, EAX, *memory);
+        Op(code, opcode[0], HOST(reg), rm);
+        break;
+    case 0x8D:  // LEA
+        if (memory == nullptr)
+            return false;
+        Address(code, HOST(reg), *memory);
+        break;
+    case 0x81:
+    case 0x83:
+    case 0xC7:  // MOV
+        if ((opcode[0] == 0xC7 && reg != 0) || (rm == NONE && memory == nullptr))
+            return false;
+        if (rm == NONE)
+            Address(code, EAX, *memory);
+        Op(code, opcode[0], reg, rm);
+        if (opcode[0] == 0x83) {
+            code.push_back(opcode[format.length - 1]);
+        }
+        else {
+            Dword(code, *(uint32_t*)(opcode + format.length - 4));
+        }
+        break;
+    case 0x05: case 0x0D: case 0x15: case 0x1D: case 0x25: case 0x2D: case 0x35: case 0x3D:
+        Op(code, 0x81, opcode[0] >> 3, HOST(0));
+        Dword(code, *(uint32_t*)(opcode + 1));
+        break;
+    case 0xA9:  // TEST
+        Op(code, 0xF7, 0, HOST(0));
+        Dword(code, *(uint32_t*)(opcode + 1));
+        break;
+    case 0x40: case 0x41: case 0x42: case 0x43: case 0x44: case 0x45: case 0x46: case 0x47:
+    case 0x48: case 0x49: case 0x4A: case 0x4B: case 0x4C: case 0x4D: case 0x4E: case 0x4F:
+        Op(code, 0xFF, (opcode[0] >> 3) & 1, HOST(opcode[0] & 0b111));
+        break;
+    case 0xA1:  // MOV EAX, moffs
+    case 0xA3:  // MOV moffs, EAX
+        Address(code, EAX, NONE, NONE, 0, *(int32_t*)(opcode + 1));
+        Op(code, (opcode[0] == 0xA1) ? 0x8B : 0x89, HOST(0), NONE);
+        break;
+    case 0xB8: case 0xB9: case 0xBA: case 0xBB: case 0xBC: case 0xBD: case 0xBE: case 0xBF:
+        Bytes(code, { 0x41, uint8_t(0xB8 | (opcode[0] & 0b111)) });
+        Dword(code, *(uint32_t*)(opcode + 1));
+        break;
+    case 0x50: case 0x51: case 0x52: case 0x53: case 0x54: case 0x55: case 0x56: case 0x57:
+    case 0x68:
+    case 0x6A:
+        if (opcode[0] == 0x68) {
+            code.push_back(0xB9);                                       // MOV ECX, imm32
+            Dword(code, *(uint32_t*)(opcode + 1));
+        }
+        else if (opcode[0] == 0x6A) {
+            code.push_back(0xB9);                                       // MOV ECX, imm8
+            Dword(code, int8_t(opcode[1]));
+        }
+        else {
+            Op(code, 0x89, HOST(opcode[0] & 0b111), ECX);               // MOV ECX, reg
+        }
+        Address(code, HOST(4), HOST(4), NONE, 0, -4);                   // LEA R12D, [R12-4]
+        Op(code, 0x89, HOST(4), EAX);                                   // MOV EAX, R12D
+        Op(code, 0x89, ECX, NONE);                                      // MOV [RSI+RAX], ECX
+        break;
+    case 0x58: case 0x59: case 0x5A: case 0x5B: case 0x5C: case 0x5D: case 0x5E: case 0x5F:
+        Op(code, 0x89, HOST(4), EAX);                                   // MOV EAX, R12D
+        Op(code, 0x8B, ECX, NONE);                                      // MOV ECX, [RSI+RAX]
+        Address(code, HOST(4), HOST(4), NONE, 0, 4);                    // LEA R12D, [R12+4]
+        Op(code, 0x89, ECX, HOST(opcode[0] & 0b111));                   // MOV reg, ECX
+        break;
+    default:
+        return false;
+    }
+    Count++;
+    return true;
+}
+//------------------------------------------------------------------------------
+bool x86_jit::End(Block& block, uint32_t address, const uint8_t* memory)
+{
+    // Entering a block costs about as much as interpreting a few instructions
+    if (Count < BLOCK_MINIMUM)
+        return false;
+
+    auto& code = Buffer;
+    if (Ended == false) {
+        Bytes(code, { 0xC7, 0x87 });                                    // MOV [RDI+IP], address
+        Dword(code, IP);
+        Dword(code, address);
+    }
+    Bytes(code, { 0x9C, 0x58 });                                        // PUSHFQ / POP RAX
+    Bytes(code, { 0x25 });                                              // AND EAX, ARITHMETIC
+    Dword(code, ARITHMETIC);
+    Bytes(code, { 0x8B, 0x8F });                                        // MOV ECX, [RDI+FLAGS]
+    Dword(code, FLAGS);
+    Bytes(code, { 0x81, 0xE1 });                                        // AND ECX, ~ARITHMETIC
+    Dword(code, ~ARITHMETIC);
+    Bytes(code, { 0x09, 0xC1, 0x89, 0x8F });                            // OR ECX, EAX / MOV [RDI+FLAGS], ECX
+    Dword(code, FLAGS);
+    for (int i = 0; i < 8; ++i) {
+        Bytes(code, { 0x44, 0x89, uint8_t(0x87 | i << 3) });           // MOV [RDI+REGS+i*8], R8D+i
+        Dword(code, REGS + i * sizeof(x86_register::register_t));
+    }
+#if defined(_WIN32)
+    Bytes(code, { 0x5E, 0x5F });                                        // POP RSI, RDI
+#endif
+    Bytes(code, { 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C });    // POP R15-R12
+    Bytes(code, { 0xC3 });                                              // RET
+
+    if (Code == nullptr) {
+#if defined(_WIN32)
+        Code = (uint8_t*)VirtualAlloc(nullptr, CODE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+        void* code = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        Code = (code != MAP_FAILED) ? (uint8_t*)code : nullptr;
+#endif
+        if (Code == nullptr)
+            return false;
+    }
+
+    // A full code cache is dropped as a whole
+    uint32_t begin = block.address;
+    if (CODE_SIZE - CodeUsed < code.size()) {
+        for (auto& block : Blocks) {
+            block.address = 0;
+            block.length = 0;
+            block.entry = nullptr;
+        }
+        CodeUsed = 0;
+    }
+
+    memcpy(Code + CodeUsed, code.data(), code.size());
+    block.address = begin;
+    block.length = uint8_t(address - begin);
+    block.count = uint8_t(Count);
+    block.entry = (x86_jit::code*)(Code + CodeUsed);
+    memcpy(block.guest, memory + begin, block.length);
+    CodeUsed = (CodeUsed + code.size() + 15) & ~size_t(15);
+    return true;
+}
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "x86_format.h"
+
+#if !defined(HAVE_JIT)
+#if defined(__x86_64__) || defined(_M_X64)
+#define HAVE_JIT 1
+#else
+#define HAVE_JIT 0
+#endif
+#endif
+
+struct x86_register;
+
+struct x86_jit
+{
+    enum { BLOCK_CACHE = 1024, BLOCK_BYTES = 128, BLOCK_HOT = 64, BLOCK_MINIMUM = 3 };
+    enum { CODE_SIZE = 1048576 };
+
+    typedef void code(x86_register& x86, uint8_t* memory);
+
+    // Translated guest block, validated against the guest bytes on every entry
+    struct Block
+    {
+        uint32_t address;
+        uint32_t hits;
+        uint8_t length;
+        uint8_t count;
+        code* entry;
+        uint8_t guest[BLOCK_BYTES];
+    };
+
+    x86_jit() = default;
+    x86_jit(const x86_jit&) = delete;
+    x86_jit& operator=(const x86_jit&) = delete;
+    ~x86_jit();
+
+    Block* Find(uint32_t address, const uint8_t* memory);
+    void Begin();
+    bool Emit(const x86_format::Format& format, const uint8_t* opcode, uint32_t address);
+    bool End(Block& block, uint32_t address, const uint8_t* memory);
+    bool Terminated() const { return Ended; }
+
+protected:
+    std::vector<Block> Blocks;
+    std::vector<uint8_t> Buffer;
+    uint8_t* Code = nullptr;
+    size_t CodeUsed = 0;
+    uint32_t Count = 0;
+    bool Ended = false;
+};